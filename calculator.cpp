@@ -29,7 +29,7 @@ inline bool Token::is_constant() const noexcept {
 
 inline bool Token::is_literal() const noexcept {
 	if (raw.empty()) return false;
-	return (raw.front() == '$' || isalpha(raw.front())) && std::all_of(std::next(raw.begin()), raw.end(), std::isalnum);
+	return (raw.front() == '$' || isalpha(raw.front())) && std::all_of(std::next(raw.begin()), raw.end(), isalnum);
 }
 
 
@@ -52,112 +52,127 @@ int calculator::Token::priority() const noexcept {
 }
 
 
-Expression::iterator calculator::skip_brackets(Expression::iterator begin, Expression::iterator end) {
-	int counter = 1;
-	if (begin->raw != "(") return begin;
-	else begin++;
-
-	while (begin != end && counter) {
-		if (begin->raw == "(") counter++;
-		if (begin->raw == ")") counter--;
-		begin++;
-	}
-	return begin;
+struct Definition::Layer {
+	std::shared_ptr<const Table> table;
+	std::shared_ptr<const Layer> parent;
+	size_t depth;
 };
 
 
-Expression::iterator calculator::read_func_argv(Expression::iterator t_begin, Expression::iterator t_end, std::list<Expression>& argv) {
-	auto end = std::prev(skip_brackets(t_begin, t_end));
-	auto begin = std::next(t_begin);
+std::shared_ptr<const Expression> Definition::find(const std::string& name) const {
+	auto def = lookup(name);
+	return def ? def->body : nullptr;
+}
 
 
-	Expression arg;
-	while (begin != end && begin != t_end) {
+const Expression* Definition::borrow(const std::string& name) const {
+	auto def = lookup(name);
+	return def ? def->body.get() : nullptr;
+}
 
-		if (begin->raw == ",") {
-			argv.push_back(Expression(arg));
-			arg.clear();
-		}
-		else if (begin->raw == "(") {
-			auto _end = skip_brackets(begin, end);
-			arg.insert(arg.end(), begin, _end);
-			begin = std::prev(_end);
-		}
-		else arg.push_back(*begin);
 
-		if (++begin == end) argv.push_back(arg);
-	}
+int Definition::arity(const std::string& name) const {
+	auto def = lookup(name);
+	return def ? def->arity : -1;
+}
+
 
-	return begin;
+// the own table shared with a fork is frozen first, so neither of them sees the change
+void Definition::define(const std::string& name, Expression expr, int arity) {
+	if (!find(name)) count++;
+	if (own.use_count() > 1) freeze();
+	(*own)[name] = { std::make_shared<const Expression>(std::move(expr)), arity };
 }
 
 
-void calculator::optimisation(Expression& expr) {
-	auto begin = expr.begin();
-	auto end = expr.end();
+// O(1): the fork copies only pointers, the parent isn't touched
+Definition Definition::fork() const {
+	Definition res = *this;
+	res.inherited = count;
+	return res;
+}
 
-	auto step_back = [&expr, &begin]() {
-		if (std::distance(expr.begin(), begin) >= 2)
-			std::advance(begin, -2);
-	};
 
-	while (begin != end) {
-		auto& a = *begin;
-		if (std::next(begin) == end) break;
+size_t Definition::size() const noexcept {
+	return count;
+}
 
-		auto& b = *std::next(begin);
 
-		// insert implicit multiplications
-		if ((a.is_constant() && (b.is_literal() || b.raw == "(")) ||
-			(a.raw == ")" && (b.is_literal() || b.is_constant())) ||
-			(a.raw == ")" && b.raw == "(")) {
-			expr.insert(std::next(begin), { "*" });
-			step_back();
-		}
+// names defined on top of the forked ones, the limit of a session applies to them
+size_t Definition::added() const noexcept {
+	return count - inherited;
+}
 
-		// identification unary plus and minus
-		if (a.is_operator() && a.raw != "(" && a.raw != ")") {
-			if (b.raw == "+") {
-				expr.erase(std::next(begin));
-				step_back();
-			}
-			if (b.raw == "-") b.raw = "~";
-		}
 
-		// erase minus and plus duplications
-		if ((a.raw == "-" && (b.raw == "-" || b.raw == "~")) ||
-			(a.raw == "~" && (b.raw == "-" || b.raw == "~")) ||
-			(a.raw == "+" && b.raw == "+")) {
-			expr.erase(std::next(begin));
-			a.raw = "+";
-			step_back();
-		}
-		if ((a.raw == "+" && (b.raw == "-" || b.raw == "~")) ||
-			((a.raw == "-" || a.raw == "~") && b.raw == "+")) {
-			expr.erase(std::next(begin));
-			a.raw = (b.raw == "~" || a.raw == "~") ? "~" : "-";
-			step_back();
-		};
-
-		begin++;
+// every defined name once, in order
+std::vector<std::string> Definition::names() const {
+	std::vector<std::string> res;
+	for (auto& entry : *own) res.push_back(entry.first);
+	for (auto layer = frozen.get(); layer; layer = layer->parent.get())
+		for (auto& entry : *layer->table) res.push_back(entry.first);
+
+	std::sort(res.begin(), res.end());
+	res.erase(std::unique(res.begin(), res.end()), res.end());
+	return res;
+}
+
+
+void Definition::clear() {
+	frozen.reset();
+	own = std::make_shared<Table>();
+	count = inherited = 0;
+}
+
+
+const Definition::Entry* Definition::lookup(const std::string& name) const {
+	Table::const_iterator iter = own->find(name);
+	if (iter != own->end()) return &iter->second;
+
+	for (auto layer = frozen.get(); layer; layer = layer->parent.get()) {
+		iter = layer->table->find(name);
+		if (iter != layer->table->end()) return &iter->second;
+	}
+	return nullptr;
+}
+
+
+void Definition::freeze() {
+	if (own->empty()) {
+		own = std::make_shared<Table>();
+		return;
 	}
-	return;
+
+	// too deep chain slows down lookups, so it is squashed into a new own table
+	if (frozen && frozen->depth >= MAX_DEFINITION_LAYERS) {
+		auto table = std::make_shared<Table>(*own);
+		for (auto layer = frozen.get(); layer; layer = layer->parent.get())
+			table->insert(layer->table->begin(), layer->table->end());
+		frozen.reset();
+		own = table;
+		return;
+	}
+
+	frozen = std::make_shared<const Layer>(Layer{ own, frozen, frozen ? frozen->depth + 1 : 1 });
+	own = std::make_shared<Table>();
 }
 
 
-Expression calculator::read_expr(const std::string& expr) {
+Result<Expression> calculator::read_expr(const std::string& expr) {
 	Expression tokens;
 
 	// reading tokens
 	Token tkn;
-	for (auto chr_iter = expr.begin(); chr_iter != expr.end(); chr_iter++) {
-		auto& chr = *chr_iter;
+	for (size_t pos = 0; pos < expr.size(); pos++) {
+		auto& chr = expr[pos];
 
-		if (isdigit(chr) || chr == '.') {
+		if (isspace(chr)) continue;
+
+		else if (isdigit(chr) || chr == '.') {
 			if (!(tkn.empty() || isalnum(tkn.raw.back()) || tkn.raw.back() == '.')) {
 				tokens.push_back(tkn);
 				tkn.clear();
 			}
+			if (tkn.empty()) tkn.pos = pos;
 			tkn.raw += chr;
 		}
 
@@ -166,6 +181,7 @@ Expression calculator::read_expr(const std::string& expr) {
 				tokens.push_back(tkn);
 				tkn.clear();
 			}
+			if (tkn.empty()) tkn.pos = pos;
 			tkn.raw += chr;
 		}
 
@@ -175,288 +191,783 @@ Expression calculator::read_expr(const std::string& expr) {
 				tkn.clear();
 			}
 			tkn.raw = chr;
+			tkn.pos = pos;
 			tokens.push_back(tkn);
 			tkn.clear();
 		}
-		else throw std::invalid_argument(std::string("Invalid symbol '") + chr + "(" + std::to_string(chr) + ")");
+		else return Error{ Error::invalid_symbol_e, pos, std::string("Invalid symbol '") + chr + "(" + std::to_string(chr) + ")" };
 	}
 	if (!tkn.empty())
 		tokens.push_back(tkn);
-	optimisation(tokens);
-
-	// typing tokens
-	for (auto tkn_iter = tokens.begin(); tkn_iter != tokens.end(); tkn_iter++)
-		tkn_iter->type = tkn_iter->what_type();
 
-	// decorating a function
+	// typing tokens, decorating functions and argument references
+	auto last = tokens.begin();
 	for (auto tkn_iter = tokens.begin(); tkn_iter != tokens.end(); tkn_iter++) {
-		auto& a = *tkn_iter;
-
-		if (std::distance(tkn_iter, tokens.end()) < 2) break;
-		auto& b = *std::next(tkn_iter);
-
-		if (a.is_literal() && b.raw == "(")
-			a.type = Token::Type::function_t;
-
-		else if (a.raw == "$" && b.is_constant()) {
-			a.raw += b.raw;
-			a.type = Token::Type::variable_t;
-			tokens.erase(std::next(tkn_iter));
+		auto next = std::next(tkn_iter);
+		auto tkn = std::move(*tkn_iter);
+		tkn.type = tkn.what_type();
+
+		if (next != tokens.end() && tkn.raw == "$" && next->is_constant()) {
+			tkn.raw += next->raw;
+			tkn.type = Token::Type::variable_t;
+			tkn.data._val = std::strtod(next->raw.c_str(), nullptr);
+			tkn_iter++;
 		}
+		else if (next != tokens.end() && tkn.is_literal() && next->raw == "(")
+			tkn.type = Token::Type::function_t;
+
+		*last++ = std::move(tkn);
 	}
+	tokens.erase(last, tokens.end());
 
 	return tokens;
 }
 
 
-Expression calculator::transform_expr(Expression::iterator begin, Expression::iterator end) {
+//-------------- add here custom functions taking a function name ---------------
+static bool method(const std::string& name) {
+	return name == "integrate" || name == "solve";
+}
+//--------------------------------------------------------------------------------
+
+
+// brackets and function calls are kept on an explicit stack, so the nesting depth costs no recursion
+Result<Expression> calculator::compile_expr(Expression::const_iterator begin, Expression::const_iterator end, const std::vector<std::string>& params) {
 	Expression rpn;
-	std::stack<Token > stack;
+	rpn.reserve(std::distance(begin, end));
 
-	while (begin != end) {
-		if (begin->is_constant() || begin->is_literal()) {
-			auto opr = *begin;
+	// operators, brackets and functions waiting for their arguments
+	struct Frame {
+		Token tkn;
+		size_t argc;
+	};
+	std::vector<Frame> stack;
 
-			if (begin->type == Token::Type::function_t) {
-				std::list<Expression> argv;
-				auto _end = std::next(read_func_argv(std::next(begin), end, argv));
+	auto is_operator = [](const Frame& frame) {
+		return frame.tkn.type == Token::Type::operator_t && frame.tkn.raw != "(";
+	};
 
-				Token argc = { std::to_string(argv.size()), Token::Type::argc_t, (size_t)argv.size() };
+	auto reduce = [&](int priority, bool right) {
+		while (stack.size() && is_operator(stack.back())) {
+			auto top = stack.back().tkn.priority();
+			if (right ? priority >= top : priority > top) break;
+			rpn.push_back(std::move(stack.back().tkn));
+			stack.pop_back();
+		}
+	};
 
-				for (auto& expr : argv) {
-					auto a = transform_expr(expr.begin(), expr.end());
-					rpn.insert(rpn.end(), a.begin(), a.end());
+	// an operand is expected at the current position
+	bool operand = true;
+
+	for (auto iter = begin; iter != end; iter++) {
+		auto& tkn = *iter;
+
+		if (operand) {
+			if (tkn.type == Token::Type::constant_t) {
+				char* last = nullptr;
+				rpn.push_back(tkn);
+				auto value = std::strtold(tkn.raw.c_str(), &last);
+				if (last == tkn.raw.c_str())
+					return Error{ Error::unknown_token_e, tkn.pos, "Invalid number '" + tkn.raw + "'" };
+
+				// a long double on the midpoint of two doubles is moved by its ulp,
+				// so it rounds to the same double as the number itself
+				auto nearest = std::strtod(tkn.raw.c_str(), nullptr);
+				if ((double)value != nearest) value = std::nextafter(value, (long double)nearest);
+				rpn.back().data._val = value;
+				operand = false;
+			}
+
+			else if (tkn.type == Token::Type::variable_t) {
+				auto param = std::find(params.begin(), params.end(), tkn.raw);
+				rpn.push_back(tkn);
+
+				// the first argument of a method names the function instead of its value
+				if (stack.size() && stack.back().tkn.type == Token::Type::function_t && !stack.back().argc &&
+					method(stack.back().tkn.raw) && std::next(iter) != end && std::next(iter)->raw == ",")
+					rpn.back().type = Token::Type::name_t;
+
+				else if (param != params.end()) {
+					rpn.back().data._val = (double)std::distance(params.begin(), param);
+					rpn.back().raw = "$" + std::to_string(std::distance(params.begin(), param));
 				}
-				rpn.push_back(argc);
-				begin = std::prev(_end);
+
+				//------------- add here custom constants -------------
+				else if (tkn.raw == "e") rpn.back() = { tkn.raw, Token::Type::constant_t, 2.718281, tkn.pos };
+				else if (tkn.raw == "pi") rpn.back() = { tkn.raw, Token::Type::constant_t, 3.141592, tkn.pos };
+				else if (tkn.raw == "tau") rpn.back() = { tkn.raw, Token::Type::constant_t, 6.283185, tkn.pos };
+				else if (tkn.raw == "phi") rpn.back() = { tkn.raw, Token::Type::constant_t, 1.618033, tkn.pos };
+				// ----------------------------------------------------
+
+				operand = false;
 			}
-			rpn.push_back(opr);
-		}
 
-		else if (begin->raw == "(") {
-			stack.push(*begin);
-		}
+			else if (tkn.type == Token::Type::function_t) {
+				stack.push_back({ tkn, 0 });
+				iter++;
 
-		else if (begin->raw == ")") {
-			while (stack.size() && stack.top().raw != "(") {
-				rpn.push_back(stack.top());
-				stack.pop();
+				// call without arguments
+				if (std::next(iter) != end && std::next(iter)->raw == ")") {
+					iter++;
+					rpn.push_back(std::move(stack.back().tkn));
+					stack.pop_back();
+					operand = false;
+				}
 			}
-			if (!stack.empty()) stack.pop();
+
+			else if (tkn.raw == "(")
+				stack.push_back({ tkn, 0 });
+
+			// unary minus binds tighter than any binary operator, unary plus changes nothing
+			else if (tkn.raw == "-" || tkn.raw == "~")
+				stack.push_back({ { "~", Token::Type::operator_t, 0, tkn.pos }, 0 });
+
+			else if (tkn.raw == "+");
+
+			else if ((tkn.raw == "," || tkn.raw == ")") && stack.size() && stack.back().tkn.type == Token::Type::function_t)
+				return Error{ Error::empty_argument_e, tkn.pos, "Empty argument for '" + stack.back().tkn.raw + "'" };
+
+			else if (tkn.type == Token::Type::operator_t && tkn.priority() > 0)
+				return Error{ Error::invalid_operation_e, tkn.pos, "Invalid operation arguments for '" + tkn.raw + "'" };
+
+			else if (tkn.type == Token::Type::operator_t)
+				return Error{ Error::invalid_expression_e, tkn.pos, "Unexpected '" + tkn.raw + "'" };
+
+			else return Error{ Error::unknown_token_e, tkn.pos, "Unknown token '" + tkn.raw + "'" };
 		}
 
-		else if (begin->is_operator()) {
-			while (stack.size() && begin->priority() <= stack.top().priority()) {
-				rpn.push_back(stack.top());
-				stack.pop();
+		else if (tkn.raw == ")") {
+			reduce(INT_MIN, false);
+			if (stack.empty())
+				return Error{ Error::invalid_expression_e, tkn.pos, "Unexpected ')'" };
+
+			if (stack.back().tkn.type == Token::Type::function_t) {
+				rpn.push_back(std::move(stack.back().tkn));
+				rpn.back().data._val = (double)stack.back().argc + 1;
 			}
-			stack.push(*begin);
+			stack.pop_back();
+		}
+
+		else if (tkn.raw == ",") {
+			reduce(INT_MIN, false);
+			if (stack.empty() || stack.back().tkn.type != Token::Type::function_t)
+				return Error{ Error::invalid_expression_e, tkn.pos, "Unexpected ','" };
+
+			stack.back().argc++;
+			operand = true;
+		}
+
+		else if (tkn.raw == "=") {
+			// only a single name can be assigned
+			auto& prev = *std::prev(iter);
+			if (prev.type != Token::Type::variable_t || rpn.back().type != Token::Type::variable_t ||
+				(stack.size() && is_operator(stack.back()) && stack.back().tkn.raw != "="))
+				return Error{ Error::invalid_assignment_e, tkn.pos, "Impossible assignment for '" + prev.raw + "'" };
+
+			rpn.back().type = Token::Type::reference_t;
+			reduce(tkn.priority(), true);
+			stack.push_back({ tkn, 0 });
+			operand = true;
+		}
+
+		else if (tkn.type == Token::Type::operator_t && tkn.priority() > 0 && tkn.raw != "~") {
+			reduce(tkn.priority(), false);
+			stack.push_back({ tkn, 0 });
+			operand = true;
 		}
-		else throw std::invalid_argument("Unknown token '" + begin->raw + "'");
 
-		begin++;
+		// implicit multiplication: "2x", "2(x)", "(x)y", "(x)(y)"
+		else if (tkn.type != Token::Type::operator_t || tkn.raw == "(") {
+			reduce(20, false);
+			stack.push_back({ { "*", Token::Type::operator_t, 0, tkn.pos }, 0 });
+			operand = true;
+			iter--;
+		}
+
+		else return Error{ Error::invalid_expression_e, tkn.pos, "Unexpected '" + tkn.raw + "'" };
 	}
 
-	while (stack.size()) {
-		rpn.push_back(stack.top());
-		stack.pop();
+	if (begin == end)
+		return Error{ Error::empty_expression_e, 0, "Empty expression" };
+
+	if (operand) {
+		auto& tkn = *std::prev(end);
+		return Error{ Error::invalid_expression_e, tkn.pos + tkn.raw.size(), "Unexpected end of expression" };
 	}
 
+	reduce(INT_MIN, false);
+	if (stack.size())
+		return Error{ Error::invalid_expression_e, stack.back().tkn.pos, "Missing ')' for '" + stack.back().tkn.raw + "'" };
+
 	return rpn;
 }
 
 
-// refresh must be true at first call
-double calculator::calc(const Expression& expr, const Definition& locals, Definition& globals, bool refresh = false) {
-	static unsigned long long recursion_depth = 0;
-	if (refresh) recursion_depth = 0;
-	else recursion_depth += 1;
+// errors inside a definition body are reported at the place where it is used
+static Error relocate(Error err, const Token& token) {
+	err.pos = token.pos;
+	return err;
+}
 
-	if (recursion_depth > MAX_CALC_RECURSION_DEPTH)
-		throw std::overflow_error("Recursion limit reached");
 
-	if (std::max(globals.size(), locals.size()) > MAX_DEFINITIONS_SIZE)
-		throw std::overflow_error("Definition limit reached");
+//------------------ add here custom functions of one argument ------------------
+template<class T = double>
+static kernels::Unary<T> builtin(const std::string& name) {
+	if (name == "sin") return kernels::sin;
+	if (name == "cos") return kernels::cos;
+	if (name == "tg") return kernels::tg;
+	if (name == "ctg") return kernels::ctg;
+	if (name == "sh") return kernels::sh;
+	if (name == "ch") return kernels::ch;
+	if (name == "th") return kernels::th;
+	if (name == "cth") return kernels::cth;
+	if (name == "exp") return kernels::exp;
+	if (name == "sqrt") return kernels::sqrt;
+	return nullptr;
+}
+//--------------------------------------------------------------------------------
+
+
+// evaluation at n argument sets at once, every value on the stack takes n lanes, so the built-ins
+// run over whole arrays; false on side effects or errors, the scalar evaluation reports them,
+// so nothing is defined meanwhile and the bodies are borrowed
+template<class T>
+static bool batch(const Expression& expr, const std::vector<const T*>& argv, size_t n, Definition& globals, T* out, size_t depth) {
+	if (depth > MAX_CALC_RECURSION_DEPTH || expr.empty()) return false;
+
+	std::vector<T> stack;
+	size_t top = 0;
+	auto at = [&](size_t i) { return stack.data() + i * n; };
+	auto push = [&]() { stack.resize(++top * n); return at(top - 1); };
+
+	for (auto& tkn : expr) {
+		if (tkn.type == Token::Type::constant_t)
+			std::fill_n(push(), n, (T)tkn.data._val);
+
+		else if (tkn.type == Token::Type::variable_t) {
+			if (tkn.raw.front() == '$') {
+				auto index = (size_t)tkn.data._val;
+				if (index >= argv.size()) return false;
+				std::copy_n(argv[index], n, push());
+			}
 
-	if (expr.empty())
-		throw std::invalid_argument("Empty expression");
+			else if (auto def = globals.borrow(tkn.raw)) {
+				if (def->empty())
+					std::fill_n(push(), n, T(0));
+				else if (def->size() == 1 && def->front().type == Token::Type::constant_t)
+					std::fill_n(push(), n, (T)def->front().data._val);
+				else if (!batch(*def, argv, n, globals, push(), depth + 1))
+					return false;
+			}
 
-	auto tod = [](Token& token, double d) {
-		token.data._val = d;
-		token.raw = std::to_string(token.data._val);
-		token.type = Token::Type::constant_t;
-	};
+			else return false;
+		}
 
-	auto tokens = expr;
-	auto begin = tokens.begin();
-	auto end = tokens.end();
+		else if (tkn.type == Token::Type::function_t) {
+			auto argc = (size_t)tkn.data._val;
+			if (top < argc) return false;
+			auto args = top - argc;
 
-	while (begin != end) {
+			if (auto fn = builtin<T>(tkn.raw)) {
+				if (!argc) return false;
+				fn(at(args), at(args), n, globals.accuracy);
+				top = args + 1;
+				stack.resize(top * n);
+			}
+
+			else if (method(tkn.raw)) return false;
+
+			else if (auto def = globals.borrow(tkn.raw)) {
+				std::vector<const T*> params(argc);
+				std::vector<T> res(n);
+				for (size_t i = 0; i < argc; i++) params[i] = at(args + i);
+				if (!batch(*def, params, n, globals, res.data(), depth + 1)) return false;
 
-		if (begin->type == Token::Type::constant_t) {
-			if (!begin->data._val)
-				begin->data._val = std::stod(begin->raw);
+				top = args + 1;
+				stack.resize(top * n);
+				std::copy(res.begin(), res.end(), at(args));
+			}
+
+			else return false;
 		}
 
-		else if (begin->type == Token::Type::variable_t) {
+		else if (tkn.type == Token::Type::operator_t && tkn.raw == "~") {
+			if (top < 1) return false;
+			auto a = at(top - 1);
+			for (size_t i = 0; i < n; i++) a[i] = -a[i];
+		}
 
-			//------------- add here custom constants -------------
-			if (begin->raw == "e") tod(*begin, 2.718281);
-			else if (begin->raw == "pi") tod(*begin, 3.141592);
-			else if (begin->raw == "tau") tod(*begin, 6.283185);
-			else if (begin->raw == "phi") tod(*begin, 1.618033);
-			// ----------------------------------------------------
+		else if (tkn.type == Token::Type::operator_t) {
+			if (top < 2) return false;
+			auto a = at(top - 2), b = at(top - 1);
 
-			else if (locals.find(begin->raw) != locals.end())
-				tod(*begin, calc(locals.at(begin->raw), locals, globals));
+			if (tkn.raw == "+") for (size_t i = 0; i < n; i++) a[i] = a[i] + b[i];
+			else if (tkn.raw == "-") for (size_t i = 0; i < n; i++) a[i] = a[i] - b[i];
+			else if (tkn.raw == "*") for (size_t i = 0; i < n; i++) a[i] = a[i] * b[i];
+			else if (tkn.raw == "/") for (size_t i = 0; i < n; i++) a[i] = a[i] / b[i];
+			else if (tkn.raw == "^") kernels::pow(a, b, a, n, globals.accuracy);
+			else return false;
 
-			else if (globals.find(begin->raw) != globals.end()) {
-				if (globals.at(begin->raw).size())
-					tod(*begin, calc(globals.at(begin->raw), locals, globals));
+			stack.resize(--top * n);
+		}
+
+		else return false;
+	}
+
+	if (top != 1) return false;
+	std::copy_n(stack.data(), n, out);
+	return true;
+}
+
+
+// values of a definition at n points of its first argument, big batches are split across the pool
+static bool sample(const Expression& expr, const double* x, double* y, size_t n, Definition& globals, size_t depth) {
+	auto& pool = Pool::shared();
+	if (!pool.size() || n * expr.size() * PARALLEL_CALC_UNIT < PARALLEL_CALC_CUTOFF)
+		return batch<double>(expr, { x }, n, globals, y, depth);
+
+	size_t tasks = std::min(n, 4 * (pool.size() + 1)), step = (n + tasks - 1) / tasks;
+	std::vector<char> done(tasks);
+	pool.run(tasks, [&](size_t task) {
+		auto begin = std::min(n, task * step), end = std::min(n, begin + step);
+		done[task] = batch<double>(expr, { x + begin }, end - begin, globals, y + begin, depth);
+	});
+	return std::all_of(done.begin(), done.end(), [](char ok) { return ok; });
+}
+
+
+// integrate(f, a, b) and solve(f, x0) call a built-in or the compiled body of f,
+// in batches while it allows, otherwise point by point through calc
+template<class T>
+static Result<T> numeric(const Token& tkn, const Token* ref, const T* args, size_t argc, Definition& globals, size_t depth) {
+	size_t needed = (tkn.raw == "integrate") ? 3 : 2;
+	bool integral = needed == 3;
+	if (argc < needed)
+		return Error{ Error::empty_argument_e, tkn.pos, "Empty argument for '" + tkn.raw + "'" };
+
+	if (argc > needed)
+		return Error{ Error::invalid_expression_e, tkn.pos, "Too many arguments for '" + tkn.raw + "'" };
+
+	if (!ref)
+		return Error{ Error::invalid_expression_e, tkn.pos, "Expected a function name for '" + tkn.raw + "'" };
+
+	auto fn = builtin(ref->raw);
+	auto def = globals.find(ref->raw);
+	if (!fn && !def)
+		return Error{ Error::undefined_function_e, ref->pos, "Undefined function '" + ref->raw + "'" };
+
+	Error err{ Error::none_e, 0, "" };
+	auto values = [&](const double* x, double* y, size_t n) {
+		if (fn) fn(x, y, n, globals.accuracy);
+		if (fn || sample(*def, x, y, n, globals, depth + 1)) return true;
+
+		for (size_t i = 0; i < n; i++) {
+			auto res = calc(*def, { x[i] }, globals, depth + 1);
+			if (!res) {
+				err = relocate(res.error(), tkn);
+				return false;
 			}
+			y[i] = res.value();
+		}
+		return true;
+	};
+
+	double res;
+	if (integral ? methods::integrate(values, (double)args[1], (double)args[2], res) : methods::solve(values, (double)args[1], res))
+		return (T)res;
+
+	if (err.code) return err;
+	if (integral) return Error{ Error::no_convergence_e, tkn.pos, "Integral of '" + ref->raw + "' doesn't converge" };
+	return Error{ Error::no_convergence_e, tkn.pos, "No root of '" + ref->raw + "' found" };
+}
+
 
-			else throw std::invalid_argument("Undefined variable '" + begin->raw + "'");
+// the kernels of the scalar type, on a single value
+template<class T>
+static T scalar(kernels::Unary<T> fn, T x, Accuracy accuracy) {
+	fn(&x, &x, 1, accuracy);
+	return x;
+}
+
+
+template<class T>
+static T power(T a, T b, Accuracy accuracy) {
+	kernels::pow(&a, &b, &a, 1, accuracy);
+	return a;
+}
+
+
+template<class T>
+static Result<T> run(const Token*, const Token*, const std::vector<T>&, Definition&, size_t, bool);
+
+
+// the limits of calc, then the whole expression without splitting it
+template<class T>
+static Result<T> enter(const Expression& expr, const std::vector<T>& argv, Definition& globals, size_t depth, bool pure) {
+	if (depth > MAX_CALC_RECURSION_DEPTH)
+		return Error{ Error::recursion_limit_e, 0, "Recursion limit reached" };
+
+	if (globals.added() > MAX_DEFINITIONS_SIZE)
+		return Error{ Error::definition_limit_e, 0, "Definition limit reached" };
+
+	if (expr.empty())
+		return Error{ Error::empty_expression_e, 0, "Empty expression" };
+
+	return run(expr.data(), expr.data() + expr.size(), argv, globals, depth, pure);
+}
+
+
+// sequential evaluation of the postfix tokens in [begin, end); a pure one has no assignments,
+// it runs on the pool and borrows the bodies, so the threads don't contend on their reference counts
+template<class T>
+static Result<T> run(const Token* begin, const Token* end, const std::vector<T>& argv, Definition& globals, size_t depth, bool pure) {
+	std::vector<T> stack;
+	// targets of the pending assignments and function names of the pending methods
+	std::vector<const Token*> targets, names;
+
+	// the owner keeps a body alive while it is evaluated, an assignment inside may replace it
+	std::shared_ptr<const Expression> owner;
+	auto lookup = [&](const std::string& name) { return pure ? globals.borrow(name) : (owner = globals.find(name)).get(); };
+
+	for (auto tkn_iter = begin; tkn_iter != end; tkn_iter++) {
+		auto& tkn = *tkn_iter;
+
+		if (tkn.type == Token::Type::constant_t)
+			stack.push_back((T)tkn.data._val);
+
+		else if (tkn.type == Token::Type::reference_t || tkn.type == Token::Type::name_t) {
+			(tkn.type == Token::Type::reference_t ? targets : names).push_back(&tkn);
+			stack.push_back(0);
 		}
 
-		else if (begin->type == Token::Type::function_t) {
-			auto _end = std::prev(begin);
-			auto _begin = _end;
+		else if (tkn.type == Token::Type::variable_t) {
+			if (tkn.raw.front() == '$') {
+				auto index = (size_t)tkn.data._val;
+				if (index >= argv.size())
+					return Error{ Error::undefined_variable_e, tkn.pos, "Undefined variable '" + tkn.raw + "'" };
+				stack.push_back(argv[index]);
+			}
+
+			else if (auto def = lookup(tkn.raw)) {
+				if (def->empty())
+					stack.push_back(0);
+				else if (def->size() == 1 && def->front().type == Token::Type::constant_t)
+					stack.push_back((T)def->front().data._val);
+				else {
+					auto res = enter(*def, argv, globals, depth + 1, pure);
+					if (!res) return relocate(res.error(), tkn);
+					stack.push_back(res.value());
+				}
+			}
+
+			// the target of a pending assignment is empty until it is assigned, "x = x + 1" gives 1
+			else if (std::any_of(targets.begin(), targets.end(), [&](const Token* ref) { return ref->raw == tkn.raw; }))
+				stack.push_back(0);
+
+			else return Error{ Error::undefined_variable_e, tkn.pos, "Undefined variable '" + tkn.raw + "'" };
+		}
 
-			if (std::distance(tokens.begin(), _begin) < _end->data._val)
-				throw std::invalid_argument("Empty argument for '" + begin->raw + "'");
-			else std::advance(_begin, -_end->data._val);
+		else if (tkn.type == Token::Type::function_t) {
+			auto argc = (size_t)tkn.data._val;
+			if (stack.size() < argc)
+				return Error{ Error::empty_argument_e, tkn.pos, "Empty argument for '" + tkn.raw + "'" };
 
-			Definition _locals;
-			for (auto iter = _begin; iter != _end; iter++)
-				_locals["$" + std::to_string(std::distance(_begin, iter))] = { *iter };
+			auto args = stack.data() + stack.size() - argc;
+			auto unary = [&](kernels::Unary<T> fn) -> Result<T> {
+				if (!argc) return Error{ Error::empty_argument_e, tkn.pos, "Empty argument for '" + tkn.raw + "'" };
+				return scalar(fn, args[0], globals.accuracy);
+			};
 
 			//----------------------------- add here custom functions -----------------------------
 			// Exapple for "sum(a, b) = a + b":
-			// if (begin->raw == "sum") {
-			//     auto arg1 = calc(_locals["$0"], locals, globals);
-			//     auto arg2 = calc(_locals["$1"], locals, globals);
-			//     tod(*begin, arg1 + arg2); 
+			// if (tkn.raw == "sum") {
+			//     if (argc != 2) res = Error{ Error::empty_argument_e, tkn.pos, "Empty argument for 'sum'" };
+			//     else res = args[0] + args[1];
 			// };
 
-			if (begin->raw == "sin")       tod(*begin, std::sin(calc(_locals["$0"], locals, globals)));
-			else if (begin->raw == "cos")  tod(*begin, std::cos(calc(_locals["$0"], locals, globals)));
-			else if (begin->raw == "tg")   tod(*begin, std::tan(calc(_locals["$0"], locals, globals)));
-			else if (begin->raw == "ctg")  tod(*begin, 1.0 / std::tan(calc(_locals["$0"], locals, globals)));
-			else if (begin->raw == "sh")   tod(*begin, std::sinh(calc(_locals["$0"], locals, globals)));
-			else if (begin->raw == "ch")   tod(*begin, std::cosh(calc(_locals["$0"], locals, globals)));
-			else if (begin->raw == "th")   tod(*begin, std::tanh(calc(_locals["$0"], locals, globals)));
-			else if (begin->raw == "cth")  tod(*begin, 1.0 / std::tanh(calc(_locals["$0"], locals, globals)));
-			else if (begin->raw == "exp")  tod(*begin, std::exp(calc(_locals["$0"], locals, globals)));
-			else if (begin->raw == "sqrt") tod(*begin, std::sqrt(calc(_locals["$0"], locals, globals)));
-			//--------------------------------------------------------------------------------------
+			Result<T> res = T(0);
+			if (auto fn = builtin<T>(tkn.raw)) res = unary(fn);
 
-			else if (globals.find(begin->raw) != globals.end()) {
-				tod(*begin, calc(globals.at(begin->raw), _locals, globals));
+			// the function name is the latest one inside the call
+			else if (method(tkn.raw)) {
+				const Token* ref = nullptr;
+				if (names.size() && names.back()->pos > tkn.pos) {
+					ref = names.back();
+					names.pop_back();
+				}
+				res = numeric(tkn, ref, args, argc, globals, depth);
 			}
+			//--------------------------------------------------------------------------------------
 
-			else throw  std::invalid_argument("Undefined function '" + begin->raw + "'");
+			else if (auto def = lookup(tkn.raw)) {
+				res = enter(*def, std::vector<T>(args, args + argc), globals, depth + 1, pure);
+				if (!res) return relocate(res.error(), tkn);
+			}
 
+			else return Error{ Error::undefined_function_e, tkn.pos, "Undefined function '" + tkn.raw + "'" };
 
-			tokens.erase(_begin, std::next(_end));
+			if (!res) return res;
+			stack.resize(stack.size() - argc);
+			stack.push_back(res.value());
 		}
 
-		else if (begin->type == Token::Type::operator_t) {
-			int argc = (begin->raw == "~") ? 1 : 2;
+		else if (tkn.type == Token::Type::operator_t) {
+			int argc = (tkn.raw == "~") ? 1 : 2;
 
-			if (std::distance(tokens.begin(), begin) < argc)
-				throw std::invalid_argument("Invalid operation arguments for '" + begin->raw + "'");
+			if (stack.size() < (size_t)argc)
+				return Error{ Error::invalid_operation_e, tkn.pos, "Invalid operation arguments for '" + tkn.raw + "'" };
 
 			if (argc == 1) {
-				auto _begin = std::prev(begin);
-				auto a = calc({ _begin, begin }, locals, globals);
-				tokens.erase(_begin);
-
-				if (begin->raw == "~") tod(*begin, -a);
-				else throw std::invalid_argument("Unknown unary operation '" + begin->raw + "'");
+				auto& a = stack.back();
+				a = -a;
 			}
 			else {
-				auto _begin = begin;
-				std::advance(_begin, -argc);
-				auto a = calc(Expression(_begin, std::next(_begin)), locals, globals);
-				auto b = calc(Expression(std::next(_begin), begin), locals, globals);
-
-				if (begin->raw == "=") {
-					if (!_begin->is_literal()) throw std::invalid_argument("Impossible assignment for '" + _begin->raw + "'");
-					auto res = *begin;
-					tod(res, b);
-					globals[_begin->raw] = { res };
-					*begin = { _begin->raw, Token::Type::variable_t, res.data._val };
+				auto b = stack.back();
+				stack.pop_back();
+				auto& a = stack.back();
+
+				if (tkn.raw == "=") {
+					if (targets.empty())
+						return Error{ Error::invalid_assignment_e, tkn.pos, "Impossible assignment for '" + tkn.raw + "'" };
+					auto ref = targets.back();
+					targets.pop_back();
+					globals.define(ref->raw, { { std::to_string(b), Token::Type::constant_t, b, ref->pos } });
+					a = b;
 				}
-				else if (begin->raw == "+") tod(*begin, a + b);
-				else if (begin->raw == "-") tod(*begin, a - b);
-				else if (begin->raw == "*") tod(*begin, a * b);
-				else if (begin->raw == "/") tod(*begin, a / b);
-				else if (begin->raw == "^") tod(*begin, std::pow(a, b));
-				else throw std::invalid_argument("Unknown binary operation '" + begin->raw + "'");
-
-				tokens.erase(_begin, begin);
+				else if (tkn.raw == "+") a = a + b;
+				else if (tkn.raw == "-") a = a - b;
+				else if (tkn.raw == "*") a = a * b;
+				else if (tkn.raw == "/") a = a / b;
+				else if (tkn.raw == "^") a = power(a, b, globals.accuracy);
+				else return Error{ Error::invalid_operation_e, tkn.pos, "Unknown binary operation '" + tkn.raw + "'" };
 			}
 		}
 
-		begin++;
+		else return Error{ Error::unknown_token_e, tkn.pos, "Unknown token '" + tkn.raw + "'" };
 	}
 
-	return tokens.front().data._val;
+	if (stack.size() != 1)
+		return Error{ Error::invalid_expression_e, std::prev(end)->pos, "Invalid expression" };
+
+	return stack.back();
 }
 
 
-// the most important function
-std::string calculator::evaluate(std::string expr, Definition& globals) {
-	expr.erase(std::remove_if(expr.begin(), expr.end(), isspace), expr.end());
-
-	if (expr.empty()) return "NAN";
-
-	try {
-		auto tokens = read_expr(expr);
-
-		// function definition
-		if (tokens.front().type == Token::Type::function_t) {
-			std::list<Expression> argv;
-			auto _begin = read_func_argv(std::next(tokens.begin()), tokens.end(), argv);
-			if (_begin != tokens.end()) _begin++;
-			else throw std::invalid_argument("Invalid expression");
-
-			if (_begin != tokens.end() && _begin->raw == "=") {
-				auto body = transform_expr(std::next(_begin), tokens.end());
-				auto argc = 0;
-
-				for (auto& arg : argv) {
-					auto lambda = [&arg](Token token) {return arg.front().raw == token.raw; };
-					auto pos = std::find_if(body.begin(), body.end(), lambda);
-					bool one_or_more = 0;
-
-					while (pos != body.end()) {
-						one_or_more = true;
-						*pos = { "$" + std::to_string(argc), Token::Type::variable_t };
-						pos = std::find_if(body.begin(), body.end(), lambda);
-					}
-					if (one_or_more) argc++;
-				}
-				globals[tokens.front().raw] = body;
-				return tokens.front().raw;
-			}
+//------------------------------------ parallel evaluation ------------------------------------
+
+// estimated costs of the subtrees of a postfix expression, start[i] is the first token of the
+// subtree ending at i; false if the evaluation has side effects and must keep its order
+static bool estimate(const Expression& expr, const Definition& globals, std::map<std::string, double>& memo,
+	std::vector<size_t>& start, std::vector<double>& cost, size_t depth) {
+	if (depth > MAX_CALC_RECURSION_DEPTH) return false;
+
+	start.resize(expr.size());
+	cost.resize(expr.size());
+	std::vector<size_t> roots;
+
+	// a definition used by name costs as much as its body
+	auto body = [&](const std::string& name, double& res) {
+		auto known = memo.find(name);
+		if (known != memo.end()) {
+			res = known->second;
+			return true;
 		}
 
-		// variable definition
-		else if (tokens.front().type == Token::Type::variable_t) {
-			if (std::next(tokens.begin()) != tokens.end() && std::next(tokens.begin())->raw == "=") {
-				globals[tokens.front().raw] = {};
-			}
+		auto def = globals.find(name);
+		if (!def || def->empty()) return true;
+
+		std::vector<size_t> _start;
+		std::vector<double> _cost;
+		memo[name] = PARALLEL_CALC_UNIT;
+		if (!estimate(*def, globals, memo, _start, _cost, depth + 1)) return false;
+		res = memo[name] = _cost.back();
+		return true;
+	};
+
+	for (size_t i = 0; i < expr.size(); i++) {
+		auto& tkn = expr[i];
+		size_t argc = 0;
+		double res = 1;
+
+		if (tkn.type == Token::Type::reference_t || tkn.type == Token::Type::name_t) return false;
+
+		else if (tkn.type == Token::Type::variable_t && tkn.raw.front() != '$') {
+			if (!body(tkn.raw, res)) return false;
 		}
 
-		auto expr = transform_expr(tokens.begin(), tokens.end());
-		return std::to_string(calc(expr, {}, globals, true));
+		else if (tkn.type == Token::Type::function_t) {
+			argc = (size_t)tkn.data._val;
+			if (!builtin(tkn.raw) && !body(tkn.raw, res)) return false;
+			res += PARALLEL_CALC_UNIT;
+		}
 
+		else if (tkn.type == Token::Type::operator_t)
+			argc = (tkn.raw == "~") ? 1 : 2;
+
+		// malformed, the sequential evaluation reports it
+		if (roots.size() < argc) return false;
+
+		start[i] = argc ? start[roots[roots.size() - argc]] : i;
+		for (; argc; argc--) {
+			res += cost[roots.back()];
+			roots.pop_back();
+		}
+		cost[i] = res;
+		roots.push_back(i);
 	}
-	catch (const std::exception& err) {
-		std::cout << "Error: " << err.what() << std::endl;
-		return err.what();
+	return roots.size() == 1;
+}
+
+
+// independent subtrees are evaluated by the pool, then the rest of the expression is evaluated
+// in the original order with their values, so the result is the same as the sequential one
+template<class T>
+static bool parallel(const Expression& expr, const std::vector<T>& argv, Definition& globals, T& value) {
+	auto& pool = Pool::shared();
+	if (!pool.size()) return false;
+
+	std::map<std::string, double> memo;
+	std::vector<size_t> start;
+	std::vector<double> cost;
+	if (!estimate(expr, globals, memo, start, cost, 0) || cost.back() < PARALLEL_CALC_CUTOFF)
+		return false;
+
+	// the biggest subtrees that fit into a chunk, the smaller than a unit stay in the rest
+	double chunk = std::max<double>(PARALLEL_CALC_UNIT, cost.back() / (8 * (pool.size() + 1)));
+	std::vector<size_t> units, nodes = { expr.size() - 1 };
+	while (nodes.size()) {
+		auto node = nodes.back();
+		nodes.pop_back();
+
+		if (cost[node] <= chunk || start[node] == node) {
+			if (cost[node] >= PARALLEL_CALC_UNIT) units.push_back(node);
+			continue;
+		}
+		for (auto child = node; child > start[node]; child = start[child - 1])
+			nodes.push_back(child - 1);
+	}
+	std::sort(units.begin(), units.end());
+
+	// neighbouring units are grouped into tasks of about a chunk
+	std::vector<size_t> tasks = { 0 };
+	double sum = 0;
+	for (size_t unit = 0; unit < units.size(); unit++) {
+		sum += cost[units[unit]];
+		if (sum >= chunk || unit + 1 == units.size()) {
+			tasks.push_back(unit + 1);
+			sum = 0;
+		}
+	}
+	if (tasks.size() < 3) return false;
+
+	std::vector<Result<T>> values(units.size(), T(0));
+	pool.run(tasks.size() - 1, [&](size_t task) {
+		for (auto unit = tasks[task]; unit < tasks[task + 1]; unit++)
+			values[unit] = run(expr.data() + start[units[unit]], expr.data() + units[unit] + 1, argv, globals, 0, true);
+	});
+
+	Expression rest;
+	for (size_t i = 0, unit = 0; i < expr.size(); i++) {
+		if (unit < units.size() && i == start[units[unit]]) {
+			// the sequential evaluation reports the first error
+			if (!values[unit]) return false;
+			rest.push_back({ "", Token::Type::constant_t, values[unit].value(), expr[units[unit]].pos });
+			i = units[unit++];
+		}
+		else rest.push_back(expr[i]);
 	}
 
-	return "NAN";
+	auto res = run(rest.data(), rest.data() + rest.size(), argv, globals, 0, true);
+	if (res) value = res.value();
+	return (bool)res;
+}
+//---------------------------------------------------------------------------------------------
+
+
+template<class T>
+Result<T> calculator::calc(const Expression& expr, const std::vector<T>& argv, Definition& globals, size_t depth) {
+	// short expressions are never split, an expression over a limit is reported by enter
+	T value;
+	if (!depth && expr.size() * PARALLEL_CALC_UNIT >= PARALLEL_CALC_CUTOFF && globals.added() <= MAX_DEFINITIONS_SIZE &&
+		parallel(expr, argv, globals, value))
+		return value;
+
+	return enter(expr, argv, globals, depth, false);
+}
+
+template Result<float> calculator::calc(const Expression&, const std::vector<float>&, Definition&, size_t);
+template Result<double> calculator::calc(const Expression&, const std::vector<double>&, Definition&, size_t);
+template Result<long double> calculator::calc(const Expression&, const std::vector<long double>&, Definition&, size_t);
+
+
+// chunks keep the value stack of a batch in cache, a chunk the batch can't take goes point by point,
+// so errors and assignments come out exactly as calc gives them
+template<class T>
+Result<std::vector<T>> calculator::calc_batch(const Expression& expr, const std::vector<const T*>& argv, size_t n, Definition& globals) {
+	const size_t chunk = 0x100;
+	std::vector<T> res(n), args(argv.size());
+	std::vector<const T*> part(argv.size());
+
+	for (size_t begin = 0; begin < n; begin += chunk) {
+		size_t size = std::min(chunk, n - begin);
+		for (size_t j = 0; j < argv.size(); j++) part[j] = argv[j] + begin;
+		if (globals.added() <= MAX_DEFINITIONS_SIZE && batch(expr, part, size, globals, &res[begin], 0)) continue;
+
+		for (size_t i = begin; i < begin + size; i++) {
+			for (size_t j = 0; j < argv.size(); j++) args[j] = argv[j][i];
+			auto value = calc(expr, args, globals);
+			if (!value) return value.error();
+			res[i] = value.value();
+		}
+	}
+	return res;
+}
+
+template Result<std::vector<float>> calculator::calc_batch(const Expression&, const std::vector<const float*>&, size_t, Definition&);
+template Result<std::vector<double>> calculator::calc_batch(const Expression&, const std::vector<const double*>&, size_t, Definition&);
+template Result<std::vector<long double>> calculator::calc_batch(const Expression&, const std::vector<const long double*>&, size_t, Definition&);
+
+
+// the most important function
+Result<std::string> calculator::evaluate(const std::string& line, Definition& globals) {
+	auto _tokens = read_expr(line);
+	if (!_tokens) return _tokens.error();
+
+	auto& tokens = _tokens.value();
+	if (tokens.empty())
+		return Error{ Error::empty_expression_e, 0, "Empty expression" };
+
+	// function definition
+	if (tokens.front().type == Token::Type::function_t) {
+		auto _end = std::next(tokens.begin(), 2);
+		for (int depth = 1; _end != tokens.end() && depth; _end++) {
+			if (_end->raw == "(") depth++;
+			if (_end->raw == ")") depth--;
+		}
+
+		if (_end != tokens.end() && _end->raw == "=") {
+			std::vector<std::string> params;
+			bool comma = false;
+			for (auto iter = std::next(tokens.begin(), 2); iter != std::prev(_end); iter++, comma = !comma) {
+				if (comma ? iter->raw != "," : iter->type != Token::Type::variable_t)
+					return Error{ Error::invalid_expression_e, iter->pos, "Invalid parameter '" + iter->raw + "' for '" + tokens.front().raw + "'" };
+				if (!comma) params.push_back(iter->raw);
+			}
+			if (params.size() && !comma)
+				return Error{ Error::invalid_expression_e, std::prev(_end)->pos, "Invalid parameter ')' for '" + tokens.front().raw + "'" };
+
+			auto body = compile_expr(std::next(_end), tokens.end(), params);
+			if (!body) return body.error();
+
+			globals.define(tokens.front().raw, std::move(body.value()), (int)params.size());
+			return tokens.front().raw;
+		}
+	}
+
+	auto expr = compile_expr(tokens.begin(), tokens.end());
+	if (!expr) return expr.error();
+
+	auto res = calc(expr.value(), {}, globals);
+	if (!res) return res.error();
+	return std::to_string(res.value());
 }
\ No newline at end of file
@@ -1,21 +1,40 @@
 #pragma once
 #include <algorithm>
-#include <exception>
-#include <iostream>
-#include <list>
+#include <climits>
+#include <cmath>
+#include <cstdio>
 #include <map>
+#include <memory>
 #include <numeric>
-#include <stack>
 #include <string>
+#include <vector>
+
+#include "kernels.h"
+#include "methods.h"
+#include "pool.h"
 
 #ifndef MAX_CALC_RECURSION_DEPTH
 #define MAX_CALC_RECURSION_DEPTH 0x400
 #endif
 
+// names a session may define on top of the ones it forked from
 #ifndef MAX_DEFINITIONS_SIZE
 #define MAX_DEFINITIONS_SIZE 0x100
 #endif 
 
+#ifndef MAX_DEFINITION_LAYERS
+#define MAX_DEFINITION_LAYERS 0x10
+#endif
+
+// estimated cost from which an expression is evaluated by the pool, a built-in call costs a unit
+#ifndef PARALLEL_CALC_CUTOFF
+#define PARALLEL_CALC_CUTOFF 0x4000
+#endif
+
+#ifndef PARALLEL_CALC_UNIT
+#define PARALLEL_CALC_UNIT 0x10
+#endif
+
 namespace calculator {
 	struct Token {
 		enum Type {
@@ -24,12 +43,15 @@ namespace calculator {
 			operator_t,
 			variable_t,
 			function_t,
-			argc_t,
+			reference_t,
+			name_t,
 		};
 
 		std::string raw;
 		Type type{ (Type)0 };
-		union Data { double _val = 0; } data;
+		// constants keep the long double precision, each scalar type of calc rounds them once
+		union Data { long double _val = 0; } data;
+		size_t pos = 0;
 
 		inline void clear() noexcept;
 		inline bool empty() const noexcept;
@@ -40,20 +62,99 @@ namespace calculator {
 		int priority() const noexcept;
 	};
 
-	typedef std::list<Token> Expression;
-	typedef std::map<std::string, Expression> Definition;
+	struct Error {
+		enum Code {
+			none_e = 0,
+			invalid_symbol_e,
+			unknown_token_e,
+			invalid_expression_e,
+			empty_expression_e,
+			empty_argument_e,
+			undefined_variable_e,
+			undefined_function_e,
+			invalid_operation_e,
+			invalid_assignment_e,
+			recursion_limit_e,
+			definition_limit_e,
+			no_convergence_e,
+		};
+
+		Code code{ none_e };
+		size_t pos = 0;
+		std::string what;
+	};
+
+	// either a value or an error, the library never throws on invalid input
+	template<class T>
+	class Result {
+	public:
+		Result(T value) : val(std::move(value)) {}
+		Result(Error error) : err(std::move(error)) {}
 
-	Expression::iterator skip_brackets(Expression::iterator, Expression::iterator);
+		explicit operator bool() const noexcept { return err.code == Error::none_e; }
+		const T& value() const noexcept { return val; }
+		T& value() noexcept { return val; }
+		const Error& error() const noexcept { return err; }
+
+	private:
+		T val{};
+		Error err;
+	};
+
+	typedef std::vector<Token> Expression;
+
+	// copy-on-write storage of definitions: a fork shares every frozen layer
+	// of its parent and pays only for the definitions it overrides,
+	// the const members may be called from several threads at once
+	class Definition {
+	public:
+		Accuracy accuracy{ libm_a };
+
+		std::shared_ptr<const Expression> find(const std::string&) const;
+		// no reference count is touched, valid until the name is defined again
+		const Expression* borrow(const std::string&) const;
+		// the number of parameters of a function, -1 for a variable or an unknown name
+		int arity(const std::string&) const;
+		void define(const std::string&, Expression, int arity = -1);
+		Definition fork() const;
+		size_t size() const noexcept;
+		size_t added() const noexcept;
+		std::vector<std::string> names() const;
+		void clear();
+
+	private:
+		struct Layer;
+		struct Entry {
+			std::shared_ptr<const Expression> body;
+			int arity;
+		};
+		typedef std::map<std::string, Entry> Table;
+
+		std::shared_ptr<const Layer> frozen;
+		std::shared_ptr<Table> own = std::make_shared<Table>();
+		size_t count = 0, inherited = 0;
+
+		const Entry* lookup(const std::string&) const;
+		void freeze();
+	};
 
-	Expression::iterator read_func_argv(Expression::iterator, Expression::iterator, std::list<Expression>&);
+	Result<Expression> read_expr(const std::string&);
 
-	void optimisation(Expression&);
+	// single pass from tokens to the postfix form, params are replaced with "$0", "$1"...
+	Result<Expression> compile_expr(Expression::const_iterator, Expression::const_iterator, const std::vector<std::string>& = {});
 
-	Expression read_expr(const std::string&);
+	// instantiated for float, double and long double, they share the tokens and the compiled form
+	template<class T = double>
+	Result<T> calc(const Expression&, const std::vector<T>&, Definition&, size_t depth = 0);
 
-	Expression transform_expr(Expression::iterator, Expression::iterator);
+	// values at n points, the i-th argument has its n values in the i-th array;
+	// the built-ins run over whole arrays, the results are the same as of calc point by point,
+	// a float array takes twice the lanes of a double one in the 4 ulp mode
+	template<class T = double>
+	Result<std::vector<T>> calc_batch(const Expression&, const std::vector<const T*>&, size_t, Definition&);
 
-	double calc(const Expression&, const Definition&, Definition&, bool);
+	Result<std::string> evaluate(const std::string&, calculator::Definition&);
 
-	std::string evaluate(std::string, calculator::Definition&);
+	// standalone C++ header with the variables and functions of a session in the given namespace
+	Result<std::string> export_header(const Definition&, const std::string& = "formulas");
 };
\ No newline at end of file
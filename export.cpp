@@ -0,0 +1,234 @@
+#include "calculator.h"
+#include <set>
+
+
+using namespace calculator;
+
+
+//------------------ add here C++ counterparts of custom functions ------------------
+// the same standard library calls as the libm accuracy of the kernels
+static const char* native(const std::string& name) {
+	if (name == "sin") return "std::sin";
+	if (name == "cos") return "std::cos";
+	if (name == "tg") return "std::tan";
+	if (name == "ctg") return "1.0 / std::tan";
+	if (name == "sh") return "std::sinh";
+	if (name == "ch") return "std::cosh";
+	if (name == "th") return "std::tanh";
+	if (name == "cth") return "1.0 / std::tanh";
+	if (name == "exp") return "std::exp";
+	if (name == "sqrt") return "std::sqrt";
+	return nullptr;
+}
+//-----------------------------------------------------------------------------------
+
+
+// names of the calculator are letters and digits, so only these keywords can collide,
+// the macros of the included headers, the lowercase ones GCC predefines in the GNU modes
+// and "std" that the generated code uses
+static bool keyword(const std::string& name) {
+	for (auto& word : { "alignas", "alignof", "and", "asm", "auto", "bitand", "bitor", "bool", "break", "case",
+		"catch", "char", "class", "compl", "concept", "const", "consteval", "constexpr", "constinit", "continue",
+		"decltype", "default", "delete", "do", "double", "else", "enum", "explicit", "export", "extern", "false",
+		"float", "for", "friend", "goto", "if", "inline", "int", "long", "mutable", "namespace", "new", "noexcept",
+		"not", "nullptr", "operator", "or", "private", "protected", "public", "register", "requires", "return",
+		"short", "signed", "sizeof", "static", "struct", "switch", "template", "this", "throw", "true", "try",
+		"typedef", "typeid", "typename", "union", "unsigned", "using", "virtual", "void", "volatile", "while", "xor",
+		"NULL", "NAN", "INFINITY", "HUGE_VAL", "HUGE_VALF", "HUGE_VALL", "errno", "unix", "linux", "i386", "std" })
+		if (name == word) return true;
+	return false;
+}
+
+
+// exactly the same double, integers get a point so they don't turn into int arithmetic
+static std::string literal(double value) {
+	if (std::isnan(value)) return "std::numeric_limits<double>::quiet_NaN()";
+	if (std::isinf(value)) return (value < 0 ? "-" : "") + std::string("std::numeric_limits<double>::infinity()");
+
+	char buf[32];
+	std::snprintf(buf, sizeof(buf), "%.17g", value);
+	std::string res = buf;
+	if (res.find_first_of(".e") == std::string::npos) res += ".0";
+	return res;
+}
+
+
+struct Entry {
+	std::shared_ptr<const Expression> body;
+	bool variable;
+	std::set<size_t> reads;  // arguments the body reads, directly or through a function used by name
+	size_t need;             // one more than the last of them, a call passes at least as many
+	size_t arity;            // parameters of the definition, the generated function takes all of them
+};
+
+
+// infix C++ of a compiled body, the parameters are "_0", "_1"... and only the read ones are named
+static Result<std::string> translate(const std::string& name, const std::map<std::string, Entry>& entries) {
+	auto& self = entries.at(name);
+	std::vector<std::string> stack;
+
+	for (auto& tkn : *self.body) {
+		if (tkn.type == Token::Type::constant_t)
+			stack.push_back(literal(tkn.data._val));
+
+		else if (tkn.type == Token::Type::variable_t && tkn.raw.front() == '$')
+			stack.push_back("_" + std::to_string((size_t)tkn.data._val));
+
+		// a function used by name reads the arguments of its caller
+		else if (tkn.type == Token::Type::variable_t) {
+			auto entry = entries.find(tkn.raw);
+			if (entry == entries.end())
+				return Error{ Error::undefined_variable_e, 0, "Undefined variable '" + tkn.raw + "' in '" + name + "'" };
+
+			std::string call = tkn.raw;
+			if (!entry->second.variable) {
+				call += "(";
+				for (size_t i = 0; i < entry->second.arity; i++)
+					call += (i ? ", " : "") + (entry->second.reads.count(i) ? "_" + std::to_string(i) : std::string("0.0"));
+				call += ")";
+			}
+			stack.push_back(call);
+		}
+
+		else if (tkn.type == Token::Type::function_t) {
+			auto argc = (size_t)tkn.data._val;
+			auto args = stack.end() - argc;
+			auto entry = entries.find(tkn.raw);
+			std::string call;
+
+			if (auto fn = native(tkn.raw)) {
+				if (!argc)
+					return Error{ Error::empty_argument_e, 0, "Empty argument for '" + tkn.raw + "' in '" + name + "'" };
+				call = "(" + std::string(fn) + "(" + *args + "))";
+			}
+
+			else if (entry == entries.end())
+				return Error{ Error::undefined_function_e, 0, "Undefined function '" + tkn.raw + "' in '" + name + "'" };
+
+			else if (entry->second.variable)
+				call = tkn.raw;
+
+			else if (argc < entry->second.need)
+				return Error{ Error::undefined_variable_e, 0, "Missing arguments for '" + tkn.raw + "' in '" + name + "'" };
+
+			// the arguments the body doesn't read may be omitted, the extra ones are dropped as calc does
+			else {
+				call = tkn.raw + "(";
+				for (size_t i = 0; i < entry->second.arity; i++)
+					call += (i ? ", " : "") + (i < argc ? args[i] : std::string("0.0"));
+				call += ")";
+			}
+
+			stack.erase(args, stack.end());
+			stack.push_back(call);
+		}
+
+		else if (tkn.raw == "~")
+			stack.back() = "(-" + stack.back() + ")";
+
+		else if (tkn.type == Token::Type::operator_t && tkn.raw != "=") {
+			auto b = stack.back();
+			stack.pop_back();
+			auto& a = stack.back();
+
+			if (tkn.raw == "^") a = "_pow(" + a + ", " + b + ")";
+			else a = "(" + a + " " + tkn.raw + " " + b + ")";
+		}
+
+		// assignments and the function names of integrate and solve
+		else return Error{ Error::invalid_operation_e, 0, "'" + tkn.raw + "' in '" + name + "' can't be exported" };
+	}
+	return stack.back();
+}
+
+
+// variables become constants and functions become inline functions with an array overload,
+// the functions are declared first, so they may use each other in any order
+Result<std::string> calculator::export_header(const Definition& globals, const std::string& space) {
+	std::map<std::string, Entry> entries;
+
+	for (auto& name : globals.names()) {
+		if (keyword(name))
+			return Error{ Error::invalid_expression_e, 0, "Name '" + name + "' can't be exported" };
+
+		// a function keeps its parameters even when its body is a constant
+		auto body = globals.find(name);
+		auto arity = globals.arity(name);
+		bool variable = arity < 0 && body->size() <= 1 && (body->empty() || body->front().type == Token::Type::constant_t);
+		entries[name] = { body, variable, {}, 0, (size_t)std::max(arity, 0) };
+	}
+
+	// the arguments read through functions used by name grow until nothing changes
+	for (bool changed = true; changed;) {
+		changed = false;
+		for (auto& entry : entries) {
+			if (entry.second.variable) continue;
+
+			auto& reads = entry.second.reads;
+			auto size = reads.size();
+			for (auto& tkn : *entry.second.body) {
+				if (tkn.type != Token::Type::variable_t) continue;
+				if (tkn.raw.front() == '$') reads.insert((size_t)tkn.data._val);
+				else if (entries.count(tkn.raw)) reads.insert(entries[tkn.raw].reads.begin(), entries[tkn.raw].reads.end());
+			}
+			changed |= reads.size() != size;
+			entry.second.need = reads.empty() ? 0 : *reads.rbegin() + 1;
+		}
+	}
+
+	// a function used by name may read more arguments than its caller has, calc fails on every call of it
+	for (auto& entry : entries)
+		if (entry.second.need > entry.second.arity)
+			return Error{ Error::undefined_variable_e, 0, "Missing arguments for a function used by name in '" + entry.first + "'" };
+
+	std::string header =
+		"// generated by the calculator, the built-ins match its libm accuracy\n"
+		"#pragma once\n"
+		"#include <cmath>\n"
+		"#include <cstddef>\n"
+		"#include <limits>\n"
+		"\n"
+		"namespace " + space + " {\n"
+		"\t// the powers of the calculator in the libm mode\n"
+		"\tinline double _pow(double _x, double _b) {\n"
+		"\t\treturn (_b == 2) ? _x * _x : (_b == -1) ? 1 / _x : std::pow(_x, _b);\n"
+		"\t}\n"
+		"\n";
+
+	std::string declarations, definitions;
+	for (auto& entry : entries) {
+		auto& name = entry.first;
+
+		if (entry.second.variable) {
+			auto value = entry.second.body->empty() ? 0.0 : entry.second.body->front().data._val;
+			header += "\tconstexpr double " + name + " = " + literal(value) + ";\n";
+			continue;
+		}
+
+		auto body = translate(name, entries);
+		if (!body) return body.error();
+
+		std::string params, arrays, args;
+		for (size_t i = 0; i < entry.second.arity; i++) {
+			bool read = entry.second.reads.count(i);
+			auto param = read ? " _" + std::to_string(i) : "";
+			params += (i ? ", double" : "double") + param;
+			arrays += "const double*" + param + ", ";
+			args += (i ? ", " : "") + (read ? "_" + std::to_string(i) + "[_i]" : std::string("0.0"));
+		}
+
+		declarations += "\tinline double " + name + "(" + params + ");\n";
+		definitions +=
+			"\n"
+			"\tinline double " + name + "(" + params + ") {\n"
+			"\t\treturn " + body.value() + ";\n"
+			"\t}\n"
+			"\n"
+			"\tinline void " + name + "(" + arrays + "double* _y, size_t _n) {\n"
+			"\t\tfor (size_t _i = 0; _i < _n; _i++) _y[_i] = " + name + "(" + args + ");\n"
+			"\t}\n";
+	}
+
+	if (declarations.size()) header += "\n" + declarations + definitions;
+	return header + "};\n";
+}
\ No newline at end of file
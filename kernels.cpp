@@ -0,0 +1,797 @@
+#include "kernels.h"
+
+
+using namespace calculator;
+
+
+// GCC completely unrolls the lanes of a block at -O3 and then leaves them scalar,
+// as a loop they are vectorised
+#if defined(__GNUC__) && !defined(__clang__)
+#define KERNEL_LOOP _Pragma("GCC unroll 1")
+#else
+#define KERNEL_LOOP
+#endif
+
+
+// vector and scalar code of a block may fuse multiplies and adds differently,
+// so where fused ones are available a tail is padded to a whole block
+#if defined(__FP_FAST_FMA) || defined(__ARM_FEATURE_FMA) || defined(__AVX2__)
+#define KERNEL_PAD_TAIL 1
+#else
+#define KERNEL_PAD_TAIL 0
+#endif
+
+
+// a block takes one register of doubles or of floats, the integers of a lane are as wide
+// as the lane, so the compilers don't mix the register widths
+template<class T>
+struct Block {
+	static const size_t lanes = KERNEL_LANES * sizeof(double) / sizeof(T);
+	typedef typename std::conditional<sizeof(T) == sizeof(double), int64_t, int32_t>::type Integer;
+};
+
+
+// lanes are computed without branches, the ones out of the kernel range are recomputed
+// by the standard library; a tail shorter than a block uses the same code with one lane
+// or with padding, so a value never depends on its position in the array
+template<class T, void (*Lanes)(const T*, T*), void (*Tail)(const T*, T*)>
+static void apply(const T* x, T* y, size_t n, T limit, T (*fallback)(T)) {
+	const size_t N = Block<T>::lanes;
+	T in[N] = {}, out[N];
+
+	for (size_t i = 0, lanes; i < n; i += lanes) {
+		lanes = std::min<size_t>(N, n - i);
+		auto block = x + i;
+
+		if (lanes < N && !KERNEL_PAD_TAIL) {
+			Tail(block, out);
+			lanes = 1;
+		}
+		else {
+			if (lanes < N) block = std::copy_n(block, lanes, in) - lanes;
+			Lanes(block, out);
+		}
+
+		for (size_t j = 0; j < lanes; j++)
+			y[i + j] = std::fabs(block[j]) <= limit ? out[j] : fallback(block[j]);
+	}
+}
+
+
+template<class T>
+static void libm(const T* x, T* y, size_t n, T (*fn)(T)) {
+	for (size_t i = 0; i < n; i++) y[i] = fn(x[i]);
+}
+
+
+// float rounds the double kernels in chunks
+static void widen(const float* x, float* y, size_t n, Accuracy acc, kernels::Unary<double> fn) {
+	double buffer[0x40];
+	for (size_t i = 0, size; i < n; i += size) {
+		size = std::min<size_t>(0x40, n - i);
+		std::copy_n(x + i, size, buffer);
+		fn(buffer, buffer, size, acc);
+		std::copy_n(buffer, size, y + i);
+	}
+}
+
+
+// nearest integer of |x| < 2^51 as a double and as an integer,
+// it relies on the default rounding, so it breaks with -ffast-math or /fp:fast
+static inline double round_int(double x, int64_t& k) {
+	const double shift = 6755399441055744.0;  // 1.5 * 2^52
+	double t = x + shift;
+	int64_t bits;
+	std::memcpy(&bits, &t, sizeof(bits));
+	k = bits - 0x4338000000000000;
+	return t - shift;
+}
+
+
+// the same for |x| < 2^22 as a float
+static inline float round_int(float x, int32_t& k) {
+	const float shift = 12582912.0f;  // 1.5 * 2^23
+	float t = x + shift;
+	int32_t bits;
+	std::memcpy(&bits, &t, sizeof(bits));
+	k = bits - 0x4B400000;
+	return t - shift;
+}
+
+
+// 2^k for -1022 <= k <= 1023
+static inline double pow2(int64_t k) {
+	uint64_t bits = (uint64_t)(k + 1023) << 52;
+	double d;
+	std::memcpy(&d, &bits, sizeof(d));
+	return d;
+}
+
+
+// 2^k for -126 <= k <= 127 as a float
+static inline float pow2f(int32_t k) {
+	uint32_t bits = (uint32_t)(k + 127) << 23;
+	float f;
+	std::memcpy(&f, &bits, sizeof(f));
+	return f;
+}
+
+
+// a ? b : c on doubles by a bit mask, a ternary turns into a branch because compilers
+// don't compute a floating point operation that may trap when it isn't needed,
+// and a branch keeps the lanes of a block from being vectorised
+static inline double select(bool a, double b, double c) {
+	uint64_t mask = 0 - (uint64_t)a, bb, cc;
+	std::memcpy(&bb, &b, sizeof(bb));
+	std::memcpy(&cc, &c, sizeof(cc));
+	bb = (bb & mask) | (cc & ~mask);
+	std::memcpy(&b, &bb, sizeof(b));
+	return b;
+}
+
+
+static inline float select(bool a, float b, float c) {
+	uint32_t mask = 0 - (uint32_t)a, bb, cc;
+	std::memcpy(&bb, &b, sizeof(bb));
+	std::memcpy(&cc, &c, sizeof(cc));
+	bb = (bb & mask) | (cc & ~mask);
+	std::memcpy(&b, &bb, sizeof(b));
+	return b;
+}
+
+
+// x with the low 32 bits of the mantissa cleared, the product of two of them is exact
+static inline double high_part(double x) {
+	uint64_t bits;
+	std::memcpy(&bits, &x, sizeof(bits));
+	bits &= 0xFFFFFFFF00000000;
+	std::memcpy(&x, &bits, sizeof(x));
+	return x;
+}
+
+
+// double-double arithmetic, the 1 ulp kernels keep a value as an unevaluated sum hi + lo
+// and round it once at the end
+
+// a + b = s + e exactly
+static inline double two_sum(double a, double b, double& e) {
+	double s = a + b, bb = s - a;
+	e = (a - (s - bb)) + (b - bb);
+	return s;
+}
+
+
+// a * b = p + e exactly, without a fused multiply-add by the splitting of Dekker,
+// which overflows for |a| or |b| above 2^995
+static inline double two_prod(double a, double b, double& e) {
+	double p = a * b;
+#if defined(__FP_FAST_FMA) || defined(__ARM_FEATURE_FMA)
+	e = std::fma(a, b, -p);
+#else
+	const double split = 134217729.0;  // 2^27 + 1
+	double t = split * a, ah = t - (t - a), al = a - ah;
+	t = split * b;
+	double bh = t - (t - b), bl = b - bh;
+	e = ((ah * bh - p) + ah * bl + al * bh) + al * bl;
+#endif
+	return p;
+}
+
+
+// (a + al) / (b + bl) = q + lo
+static inline double dd_div(double a, double al, double b, double bl, double& lo) {
+	double q = a / b, pe, p = two_prod(q, b, pe);
+	lo = (((a - p) - pe) + (al - q * bl)) / b;
+	return q;
+}
+
+
+//----------------------------------------- sin, cos -----------------------------------------
+// Cody-Waite reduction by pi/2 and fdlibm polynomials on [-pi/4, pi/4], within 1 ulp
+
+static const double pio2_limit = 823549.6654;  // 2^19 * pi/2
+static const double invpio2 = 6.36619772367581382433e-01;
+static const double pio2_1 = 1.57079632673412561417e+00, pio2_1t = 6.07710050650619224932e-11;
+static const double pio2_2 = 6.07710050630396597660e-11, pio2_2t = 2.02226624879595063154e-21;
+static const double pio2_3 = 2.02226624871116645580e-21, pio2_3t = 8.47842766036889956997e-32;
+
+
+// x = k * pi/2 + r + rr, the third 33 bits of pi/2 are used only on a heavy cancellation
+static inline void reduce_pio2(double x, double& r, double& rr, int64_t& k) {
+	double fn = round_int(x * invpio2, k);
+	double t, w, r3, w3;
+
+	t = x - fn * pio2_1;
+	w = fn * pio2_2; r = t - w; w = fn * pio2_2t - ((t - r) - w);
+	t = r;
+	w3 = fn * pio2_3; r3 = t - w3; w3 = fn * pio2_3t - ((t - r3) - w3);
+
+	bool cancellation = std::fabs(r - w) < std::fabs(x) * 1.7763568394002505e-15;  // 2^-49
+	r = select(cancellation, r3, r);
+	w = select(cancellation, w3, w);
+
+	t = r - w;
+	rr = (r - t) - w;
+	r = t;
+}
+
+
+static inline double ksin(double x, double y) {
+	const double S1 = -1.66666666666666324348e-01, S2 = 8.33333333332248946124e-03,
+		S3 = -1.98412698298579493134e-04, S4 = 2.75573137070700676789e-06,
+		S5 = -2.50507602534068634195e-08, S6 = 1.58969099521155010221e-10;
+
+	double z = x * x, v = z * x;
+	double r = S2 + z * (S3 + z * (S4 + z * (S5 + z * S6)));
+	return x - ((z * (0.5 * y - v * r) - y) - v * S1);
+}
+
+
+static inline double kcos(double x, double y) {
+	const double C1 = 4.16666666666666019037e-02, C2 = -1.38888888888741095749e-03,
+		C3 = 2.48015872894767294178e-05, C4 = -2.75573143513906633035e-07,
+		C5 = 2.08757232129817482790e-09, C6 = -1.13596475577881948265e-11;
+
+	double z = x * x;
+	double r = z * (C1 + z * (C2 + z * (C3 + z * (C4 + z * (C5 + z * C6)))));
+	double hz = 0.5 * z, w = 1.0 - hz;
+	return w + (((1.0 - w) - hz) + (z * r - x * y));
+}
+
+
+// float subtracts the multiple of pi/2 in double, a float pi/2 in pieces loses everything
+// near its multiples, and the Cephes polynomials take the rest within 1.3 ulp
+static inline void reduce_pio2(float x, float& r, float& rr, int32_t& k) {
+	double fn = round_int(x * (float)invpio2, k);
+	double t = (x - fn * pio2_1) - fn * pio2_1t;
+	r = (float)t;
+	rr = (float)(t - r);
+}
+
+
+static inline float ksin(float x, float y) {
+	const float S1 = -1.6666654611e-1f, S2 = 8.3321608736e-3f, S3 = -1.9515295891e-4f;
+
+	float z = x * x;
+	return x + (x * z * (S1 + z * (S2 + z * S3)) + y);
+}
+
+
+static inline float kcos(float x, float y) {
+	const float C1 = 4.166664568298827e-2f, C2 = -1.388731625493765e-3f, C3 = 2.443315711809948e-5f;
+
+	float z = x * x;
+	return 1.0f - 0.5f * z + (z * z * (C1 + z * (C2 + z * C3)) - x * y);
+}
+
+
+// Quadrant 0 is sin, 1 is cos, 2 is -sin, 3 is -cos; a cosine starts one quadrant later
+template<class T, size_t N, int Shift>
+static void sincos_block(const T* x, T* y) {
+	KERNEL_LOOP
+	for (size_t i = 0; i < N; i++) {
+		T r, rr;
+		typename Block<T>::Integer k;
+		reduce_pio2(x[i], r, rr, k);
+		k += Shift;
+
+		T s = ksin(r, rr), c = kcos(r, rr);
+		T v = select(k & 1, c, s);
+		y[i] = select(k & 2, -v, v);
+	}
+}
+
+
+// tg = sin / cos, ctg = cos / sin, an odd quadrant swaps them and changes the sign;
+// the division costs up to 2 more ulp, so these are used only in the 4 ulp mode
+template<class T, size_t N, bool Inverse>
+static void tg_block(const T* x, T* y) {
+	KERNEL_LOOP
+	for (size_t i = 0; i < N; i++) {
+		T r, rr;
+		typename Block<T>::Integer k;
+		reduce_pio2(x[i], r, rr, k);
+
+		T s = ksin(r, rr), c = kcos(r, rr);
+		bool swap = (k & 1) != Inverse;
+		T t = select(swap, c / s, s / c);
+		y[i] = select(k & 1, -t, t);
+	}
+}
+
+
+// the fdlibm kernel of tan(x + y) on [-pi/4, pi/4], or of -1 / tan(x + y) without the error
+// of a division; above 0.6744 it takes tan(pi/4 - x), both within 1 ulp
+static inline double ktan(double x, double y, bool inverse) {
+	const double T0 = 3.33333333333334091986e-01, T1 = 1.33333333333201242699e-01,
+		T2 = 5.39682539762260521377e-02, T3 = 2.18694882948595424599e-02,
+		T4 = 8.86323982359930005737e-03, T5 = 3.59207910759131235356e-03,
+		T6 = 1.45620945432529025516e-03, T7 = 5.88041240820264096874e-04,
+		T8 = 2.46463134818469906812e-04, T9 = 7.81794442939557092300e-05,
+		T10 = 7.14072491382608190305e-05, T11 = -1.85586374855275456654e-05,
+		T12 = 2.59073051863633712884e-05;
+	const double pio4 = 7.85398163397448278999e-01, pio4lo = 3.06161699786838301793e-17;
+
+	double sign = std::copysign(1.0, x), a = std::fabs(x);
+	bool big = a >= 0.6744;
+	x = select(big, (pio4 - a) + (pio4lo - sign * y), x);
+	y = select(big, 0.0, y);
+
+	double z = x * x, w = z * z;
+	double r = T1 + w * (T3 + w * (T5 + w * (T7 + w * (T9 + w * T11))));
+	double v = z * (T2 + w * (T4 + w * (T6 + w * (T8 + w * (T10 + w * T12)))));
+	double s = z * x;
+	r = y + z * (s * (r + v) + y);
+	r += T0 * s;
+	w = x + r;
+
+	double iy = select(inverse, -1.0, 1.0);
+	double far = sign * (iy - 2.0 * (x - (w * w / (w + iy) - r)));
+
+	// -1 / w from a quotient t with half of the bits and its correction
+	double hi = high_part(w), lo = r - (hi - x);
+	double q = -1.0 / w, t = high_part(q);
+	double near = select(inverse, t + q * ((1.0 + t * hi) + t * lo), w);
+	near = select(inverse & (a < 3.7252902984e-09), -1.0 / x, near);  // 2^-28, x + y is x there
+	return select(big, far, near);
+}
+
+
+// tg(x) is tan(r) in an even quadrant and -1 / tan(r) in an odd one, ctg(x) is the other one negated
+template<size_t N, bool Inverse>
+static void tg1_block(const double* x, double* y) {
+	KERNEL_LOOP
+	for (size_t i = 0; i < N; i++) {
+		double r, rr;
+		int64_t k;
+		reduce_pio2(x[i], r, rr, k);
+
+		double t = ktan(r, rr, (k & 1) != Inverse);
+		y[i] = Inverse ? -t : t;
+	}
+}
+
+
+//-------------------------------------------- exp -------------------------------------------
+// exp(x) = 2^k * exp(r), |r| <= ln2 / 2, fdlibm rational form within 1 ulp in both modes,
+// the Cephes polynomial within 1 ulp of float
+
+static const double exp_limit = 708.0;
+static const float expf_limit = 87.0f;
+static const double invln2 = 1.44269504088896338700e+00;
+static const double ln2_hi = 6.93147180369123816490e-01, ln2_lo = 1.90821492927058770002e-10;
+
+// 1 / n!
+static const double inv_factorial[] = {
+	1.0, 1.0, 1.0 / 2, 1.0 / 6, 1.0 / 24, 1.0 / 120, 1.0 / 720, 1.0 / 5040, 1.0 / 40320,
+	1.0 / 362880, 1.0 / 3628800, 1.0 / 39916800, 1.0 / 479001600, 1.0 / 6227020800,
+	1.0 / 87178291200, 1.0 / 1307674368000, 1.0 / 20922789888000, 1.0 / 355687428096000,
+};
+
+
+static inline double kexp(double x) {
+	const double P1 = 1.66666666666666019037e-01, P2 = -2.77777777770155933842e-03,
+		P3 = 6.61375632143793436117e-05, P4 = -1.65339022054652515390e-06,
+		P5 = 4.13813679705723846039e-08;
+
+	int64_t k;
+	double fn = round_int(x * invln2, k);
+	double hi = x - fn * ln2_hi, lo = fn * ln2_lo;
+	double r = hi - lo, z = r * r;
+	double c = r - z * (P1 + z * (P2 + z * (P3 + z * (P4 + z * P5))));
+	return (1.0 - ((lo - (r * c) / (2.0 - c)) - hi)) * pow2(k);
+}
+
+
+static inline float kexp(float x) {
+	const float ln2f_hi = 0.693359375f, ln2f_lo = -2.12194440e-4f;
+	const float P0 = 1.9875691500e-4f, P1 = 1.3981999507e-3f, P2 = 8.3334519073e-3f,
+		P3 = 4.1665795894e-2f, P4 = 1.6666665459e-1f, P5 = 5.0000001201e-1f;
+
+	int32_t k;
+	float fn = round_int(x * (float)invln2, k);
+	float r = (x - fn * ln2f_hi) - fn * ln2f_lo, z = r * r;
+	float p = P5 + r * (P4 + r * (P3 + r * (P2 + r * (P1 + r * P0))));
+	return (p * z + r + 1.0f) * pow2f(k);
+}
+
+
+template<class T, size_t N>
+static void exp_block(const T* x, T* y) {
+	KERNEL_LOOP
+	for (size_t i = 0; i < N; i++) y[i] = kexp(x[i]);
+}
+
+
+//------------------------------------- sh, ch, th, cth -------------------------------------
+// through exp, with the Taylor series of sh near zero where exp(x) - exp(-x) cancels
+
+static inline double ksh_small(double x) {
+	double z = x * x, s = inv_factorial[17];
+	for (int n = 15; n >= 1; n -= 2) s = s * z + inv_factorial[n];
+	return s * x;
+}
+
+
+// float adds the terms past x to x and takes ch of the small th from its series too,
+// otherwise their rounding errors add up to almost 4 ulp
+static inline float ksh_small(float x) {
+	float z = x * x, s = (float)inv_factorial[11];
+	for (int n = 9; n >= 3; n -= 2) s = s * z + (float)inv_factorial[n];
+	return x + x * z * s;
+}
+
+
+static inline double kch_small(double, double e) {
+	return 0.5 * (e + 1.0 / e);
+}
+
+
+static inline float kch_small(float x, float) {
+	float z = x * x, s = (float)inv_factorial[10];
+	for (int n = 8; n >= 2; n -= 2) s = s * z + (float)inv_factorial[n];
+	return 1 + z * s;
+}
+
+
+template<class T, size_t N>
+static void sh_block(const T* x, T* y) {
+	KERNEL_LOOP
+	for (size_t i = 0; i < N; i++) {
+		T e = kexp(std::fabs(x[i]));
+		T big = std::copysign(T(0.5) * (e - 1 / e), x[i]);
+		y[i] = select(std::fabs(x[i]) < 1, ksh_small(x[i]), big);
+	}
+}
+
+
+template<class T, size_t N>
+static void ch_block(const T* x, T* y) {
+	KERNEL_LOOP
+	for (size_t i = 0; i < N; i++) {
+		T e = kexp(std::fabs(x[i]));
+		y[i] = T(0.5) * (e + 1 / e);
+	}
+}
+
+
+template<class T, size_t N, bool Inverse>
+static void th_block(const T* x, T* y) {
+	KERNEL_LOOP
+	for (size_t i = 0; i < N; i++) {
+		T a = std::fabs(x[i]);
+		a = select(a > 22, T(22), a);
+		T e = kexp(a);
+		T sh = ksh_small(a), ch = kch_small(a, e);
+		T small = Inverse ? ch / sh : sh / ch;
+		T big = Inverse ? 1 + 2 / (e * e - 1) : 1 - 2 / (e * e + 1);
+		y[i] = std::copysign(select(a < 1, small, big), x[i]);
+	}
+}
+
+
+// the 1 ulp mode takes them from m = e^|x| - 1 in double-double, as
+// sh = (m + m / (m + 1)) / 2, ch = (m + 1 + 1 / (m + 1)) / 2, th = m2 / (m2 + 2), cth = 1 + 2 / m2
+// with m2 = e^2|x| - 1, so nothing cancels and the result is rounded once
+
+// e^x - 1 = hi + lo for 0 <= x <= 708 within 2^-56: x = k ln2 + r, the Taylor series of e^r - 1
+// with r + r^2 / 2 exact, then 2^k (e^r - 1) + 2^k - 1
+static inline double kexpm1(double x, double& lo) {
+	int64_t k;
+	double fn = round_int(x * invln2, k);
+	double rl, r = two_sum(x - fn * ln2_hi, -fn * ln2_lo, rl);
+
+	double q = inv_factorial[16];
+	for (int n = 15; n >= 3; n--) q = q * r + inv_factorial[n];
+	double pe, p = two_prod(r, r, pe);
+	q *= p * r;
+
+	double e1, e2, m = two_sum(r, 0.5 * p, e1);
+	m = two_sum(m, q, e2);
+	double ml = (e1 + e2) + 0.5 * pe + rl * (1 + m);
+
+	double a = pow2(k), e3, e4, s = two_sum(a, -1.0, e3);
+	double hi = two_sum(a * m, s, e4);
+	lo = (e3 + e4) + a * ml;
+	return hi;
+}
+
+
+// above 20 the terms 1 / (m + 1) are below 2^-57 of the result and a plain division is enough,
+// the double-double one may overflow there
+template<size_t N, bool Cosine>
+static void sh1_block(const double* x, double* y) {
+	KERNEL_LOOP
+	for (size_t i = 0; i < N; i++) {
+		double a = std::fabs(x[i]), ml, m = kexpm1(a, ml);
+		double el, e = two_sum(m, 1.0, el);
+		el += ml;
+
+		// m / (m + 1) for sh, 1 / (m + 1) for ch
+		double fl, f = dd_div(Cosine ? 1.0 : m, Cosine ? 0.0 : ml, e, el, fl);
+		f = select(a > 20, Cosine ? 1 / e : 1 - 1 / e, f);
+		fl = select(a > 20, 0.0, fl);
+
+		double sl, s = two_sum(Cosine ? e : m, f, sl);
+		double v = 0.5 * (s + (sl + (Cosine ? el : ml) + fl));
+		y[i] = Cosine ? v : std::copysign(v, x[i]);
+	}
+}
+
+
+template<size_t N, bool Inverse>
+static void th1_block(const double* x, double* y) {
+	KERNEL_LOOP
+	for (size_t i = 0; i < N; i++) {
+		double a = std::fabs(x[i]);
+		a = select(a > 22, 22.0, a);
+		double ml, m = kexpm1(2 * a, ml);
+		double el, e = two_sum(m, 2.0, el);
+		el += ml;
+
+		double v, vl;
+		if (Inverse) {
+			double q = dd_div(2.0, 0.0, m, ml, vl), sl;
+			v = two_sum(1.0, q, sl);
+			vl += sl;
+		}
+		else v = dd_div(m, ml, e, el, vl);
+
+		// cth(x) = 1 / x + x / 3 - ..., 1 / x alone is rounded correctly below 2^-28
+		v = v + vl;
+		if (Inverse) v = select(a < 3.7252902984e-09, 1 / a, v);
+		y[i] = std::copysign(v, x[i]);
+	}
+}
+
+
+//-------------------------------------------- pow -------------------------------------------
+// small integer exponents by multiplication, everything else by the standard library
+
+template<class T, size_t N, int Low, int High>
+static void pow_block(const T* x, const T* b, T* y) {
+	KERNEL_LOOP
+	for (size_t i = 0; i < N; i++) {
+		int e = (int)select((b[i] >= Low) & (b[i] <= High), b[i], T(0));
+
+		T p = 1;
+		for (int j = 0; j < std::max(-Low, High); j++)
+			p = select(j < std::abs(e), p * x[i], p);
+
+		// 1 / p loses the result when p has overflowed or is subnormal, as with 1e80^-4,
+		// these lanes give NaN and are recomputed by the standard library
+		T a = std::fabs(p);
+		bool normal = (a == 0) | ((a >= std::numeric_limits<T>::min()) & (a <= std::numeric_limits<T>::max()));
+		y[i] = select(e < 0, select(normal, 1 / p, T(NAN)), p);
+	}
+}
+
+
+// the same scheme as apply, the lanes with other exponents or a NaN are recomputed by the standard library
+template<class T, int Low, int High>
+static void pow_apply(const T* x, const T* b, T* y, size_t n) {
+	const size_t N = Block<T>::lanes;
+	T in[N] = {}, exponent[N] = {}, out[N];
+	auto integer = [](T e) { return e >= Low && e <= High && std::floor(e) == e; };
+
+	for (size_t i = 0, lanes; i < n; i += lanes) {
+		lanes = std::min<size_t>(N, n - i);
+		auto block = x + i, power = b + i;
+
+		if (lanes < N && !KERNEL_PAD_TAIL) {
+			pow_block<T, 1, Low, High>(block, power, out);
+			lanes = 1;
+		}
+		else {
+			if (lanes < N) {
+				block = std::copy_n(block, lanes, in) - lanes;
+				power = std::copy_n(power, lanes, exponent) - lanes;
+			}
+			pow_block<T, N, Low, High>(block, power, out);
+		}
+
+		for (size_t j = 0; j < lanes; j++)
+			y[i + j] = integer(power[j]) && !std::isnan(out[j]) ? out[j] : std::pow(block[j], power[j]);
+	}
+}
+
+
+//----------------------------------------- interface ----------------------------------------
+
+template<class T> static T libm_sin(T x) { return std::sin(x); }
+template<class T> static T libm_cos(T x) { return std::cos(x); }
+template<class T> static T libm_tg(T x) { return std::tan(x); }
+template<class T> static T libm_ctg(T x) { return 1 / std::tan(x); }
+template<class T> static T libm_sh(T x) { return std::sinh(x); }
+template<class T> static T libm_ch(T x) { return std::cosh(x); }
+template<class T> static T libm_th(T x) { return std::tanh(x); }
+template<class T> static T libm_cth(T x) { return 1 / std::tanh(x); }
+template<class T> static T libm_exp(T x) { return std::exp(x); }
+template<class T> static T libm_sqrt(T x) { return std::sqrt(x); }
+
+
+// beyond the kernel ranges the 1 ulp mode rounds the long double function once
+template<long double (*Fn)(long double)>
+static double wide(double x) { return (double)Fn(x); }
+
+
+// a square and a reciprocal are rounded once, as the compilers fold std::pow with these exponents
+template<class T>
+static void libm_pow(const T* x, const T* b, T* y, size_t n) {
+	for (size_t i = 0; i < n; i++) y[i] = (b[i] == 2) ? x[i] * x[i] : (b[i] == -1) ? 1 / x[i] : std::pow(x[i], b[i]);
+}
+
+
+//------------------------------------------ double ------------------------------------------
+
+void kernels::sin(const double* x, double* y, size_t n, Accuracy acc) {
+	if (acc == libm_a) libm(x, y, n, libm_sin<double>);
+	else apply<double, sincos_block<double, KERNEL_LANES, 0>, sincos_block<double, 1, 0>>(x, y, n, pio2_limit, libm_sin<double>);
+}
+
+
+void kernels::cos(const double* x, double* y, size_t n, Accuracy acc) {
+	if (acc == libm_a) libm(x, y, n, libm_cos<double>);
+	else apply<double, sincos_block<double, KERNEL_LANES, 1>, sincos_block<double, 1, 1>>(x, y, n, pio2_limit, libm_cos<double>);
+}
+
+
+void kernels::tg(const double* x, double* y, size_t n, Accuracy acc) {
+	if (acc == libm_a) libm(x, y, n, libm_tg<double>);
+	else if (acc == ulp1_a) apply<double, tg1_block<KERNEL_LANES, false>, tg1_block<1, false>>(x, y, n, pio2_limit, wide<libm_tg<long double>>);
+	else apply<double, tg_block<double, KERNEL_LANES, false>, tg_block<double, 1, false>>(x, y, n, pio2_limit, libm_tg<double>);
+}
+
+
+void kernels::ctg(const double* x, double* y, size_t n, Accuracy acc) {
+	if (acc == libm_a) libm(x, y, n, libm_ctg<double>);
+	else if (acc == ulp1_a) apply<double, tg1_block<KERNEL_LANES, true>, tg1_block<1, true>>(x, y, n, pio2_limit, wide<libm_ctg<long double>>);
+	else apply<double, tg_block<double, KERNEL_LANES, true>, tg_block<double, 1, true>>(x, y, n, pio2_limit, libm_ctg<double>);
+}
+
+
+void kernels::sh(const double* x, double* y, size_t n, Accuracy acc) {
+	if (acc == libm_a) libm(x, y, n, libm_sh<double>);
+	else if (acc == ulp1_a) apply<double, sh1_block<KERNEL_LANES, false>, sh1_block<1, false>>(x, y, n, exp_limit, wide<libm_sh<long double>>);
+	else apply<double, sh_block<double, KERNEL_LANES>, sh_block<double, 1>>(x, y, n, exp_limit, libm_sh<double>);
+}
+
+
+void kernels::ch(const double* x, double* y, size_t n, Accuracy acc) {
+	if (acc == libm_a) libm(x, y, n, libm_ch<double>);
+	else if (acc == ulp1_a) apply<double, sh1_block<KERNEL_LANES, true>, sh1_block<1, true>>(x, y, n, exp_limit, wide<libm_ch<long double>>);
+	else apply<double, ch_block<double, KERNEL_LANES>, ch_block<double, 1>>(x, y, n, exp_limit, libm_ch<double>);
+}
+
+
+void kernels::th(const double* x, double* y, size_t n, Accuracy acc) {
+	if (acc == libm_a) libm(x, y, n, libm_th<double>);
+	else if (acc == ulp1_a) apply<double, th1_block<KERNEL_LANES, false>, th1_block<1, false>>(x, y, n, HUGE_VAL, libm_th<double>);
+	else apply<double, th_block<double, KERNEL_LANES, false>, th_block<double, 1, false>>(x, y, n, HUGE_VAL, libm_th<double>);
+}
+
+
+void kernels::cth(const double* x, double* y, size_t n, Accuracy acc) {
+	if (acc == libm_a) libm(x, y, n, libm_cth<double>);
+	else if (acc == ulp1_a) apply<double, th1_block<KERNEL_LANES, true>, th1_block<1, true>>(x, y, n, HUGE_VAL, libm_cth<double>);
+	else apply<double, th_block<double, KERNEL_LANES, true>, th_block<double, 1, true>>(x, y, n, HUGE_VAL, libm_cth<double>);
+}
+
+
+void kernels::exp(const double* x, double* y, size_t n, Accuracy acc) {
+	if (acc == libm_a) libm(x, y, n, libm_exp<double>);
+	else apply<double, exp_block<double, KERNEL_LANES>, exp_block<double, 1>>(x, y, n, exp_limit, libm_exp<double>);
+}
+
+
+// correctly rounded by the hardware in every mode
+void kernels::sqrt(const double* x, double* y, size_t n, Accuracy) {
+	libm(x, y, n, libm_sqrt<double>);
+}
+
+
+void kernels::pow(const double* x, const double* b, double* y, size_t n, Accuracy acc) {
+	if (acc == libm_a) libm_pow(x, b, y, n);
+	else if (acc == ulp1_a) pow_apply<double, -1, 2>(x, b, y, n);
+	else pow_apply<double, -4, 4>(x, b, y, n);
+}
+
+
+//------------------------------------------- float ------------------------------------------
+// a block of floats has 2 * KERNEL_LANES lanes
+
+static const size_t F = 2 * KERNEL_LANES;
+
+
+void kernels::sin(const float* x, float* y, size_t n, Accuracy acc) {
+	if (acc == libm_a) libm(x, y, n, libm_sin<float>);
+	else if (acc == ulp1_a) widen(x, y, n, acc, kernels::sin);
+	else apply<float, sincos_block<float, F, 0>, sincos_block<float, 1, 0>>(x, y, n, (float)pio2_limit, libm_sin<float>);
+}
+
+
+void kernels::cos(const float* x, float* y, size_t n, Accuracy acc) {
+	if (acc == libm_a) libm(x, y, n, libm_cos<float>);
+	else if (acc == ulp1_a) widen(x, y, n, acc, kernels::cos);
+	else apply<float, sincos_block<float, F, 1>, sincos_block<float, 1, 1>>(x, y, n, (float)pio2_limit, libm_cos<float>);
+}
+
+
+void kernels::tg(const float* x, float* y, size_t n, Accuracy acc) {
+	if (acc == libm_a) libm(x, y, n, libm_tg<float>);
+	else if (acc == ulp1_a) widen(x, y, n, acc, kernels::tg);
+	else apply<float, tg_block<float, F, false>, tg_block<float, 1, false>>(x, y, n, (float)pio2_limit, libm_tg<float>);
+}
+
+
+void kernels::ctg(const float* x, float* y, size_t n, Accuracy acc) {
+	if (acc == libm_a) libm(x, y, n, libm_ctg<float>);
+	else if (acc == ulp1_a) widen(x, y, n, acc, kernels::ctg);
+	else apply<float, tg_block<float, F, true>, tg_block<float, 1, true>>(x, y, n, (float)pio2_limit, libm_ctg<float>);
+}
+
+
+void kernels::sh(const float* x, float* y, size_t n, Accuracy acc) {
+	if (acc == libm_a) libm(x, y, n, libm_sh<float>);
+	else if (acc == ulp1_a) widen(x, y, n, acc, kernels::sh);
+	else apply<float, sh_block<float, F>, sh_block<float, 1>>(x, y, n, expf_limit, libm_sh<float>);
+}
+
+
+void kernels::ch(const float* x, float* y, size_t n, Accuracy acc) {
+	if (acc == libm_a) libm(x, y, n, libm_ch<float>);
+	else if (acc == ulp1_a) widen(x, y, n, acc, kernels::ch);
+	else apply<float, ch_block<float, F>, ch_block<float, 1>>(x, y, n, expf_limit, libm_ch<float>);
+}
+
+
+void kernels::th(const float* x, float* y, size_t n, Accuracy acc) {
+	if (acc == libm_a) libm(x, y, n, libm_th<float>);
+	else if (acc == ulp1_a) widen(x, y, n, acc, kernels::th);
+	else apply<float, th_block<float, F, false>, th_block<float, 1, false>>(x, y, n, HUGE_VALF, libm_th<float>);
+}
+
+
+void kernels::cth(const float* x, float* y, size_t n, Accuracy acc) {
+	if (acc == libm_a) libm(x, y, n, libm_cth<float>);
+	else if (acc == ulp1_a) widen(x, y, n, acc, kernels::cth);
+	else apply<float, th_block<float, F, true>, th_block<float, 1, true>>(x, y, n, HUGE_VALF, libm_cth<float>);
+}
+
+
+void kernels::exp(const float* x, float* y, size_t n, Accuracy acc) {
+	if (acc == libm_a) libm(x, y, n, libm_exp<float>);
+	else if (acc == ulp1_a) widen(x, y, n, acc, kernels::exp);
+	else apply<float, exp_block<float, F>, exp_block<float, 1>>(x, y, n, expf_limit, libm_exp<float>);
+}
+
+
+void kernels::sqrt(const float* x, float* y, size_t n, Accuracy) {
+	libm(x, y, n, libm_sqrt<float>);
+}
+
+
+void kernels::pow(const float* x, const float* b, float* y, size_t n, Accuracy acc) {
+	if (acc == libm_a) libm_pow(x, b, y, n);
+	else if (acc == ulp1_a) pow_apply<float, -1, 2>(x, b, y, n);
+	else pow_apply<float, -4, 4>(x, b, y, n);
+}
+
+
+//---------------------------------------- long double ---------------------------------------
+
+void kernels::sin(const long double* x, long double* y, size_t n, Accuracy) { libm(x, y, n, libm_sin<long double>); }
+void kernels::cos(const long double* x, long double* y, size_t n, Accuracy) { libm(x, y, n, libm_cos<long double>); }
+void kernels::tg(const long double* x, long double* y, size_t n, Accuracy) { libm(x, y, n, libm_tg<long double>); }
+void kernels::ctg(const long double* x, long double* y, size_t n, Accuracy) { libm(x, y, n, libm_ctg<long double>); }
+void kernels::sh(const long double* x, long double* y, size_t n, Accuracy) { libm(x, y, n, libm_sh<long double>); }
+void kernels::ch(const long double* x, long double* y, size_t n, Accuracy) { libm(x, y, n, libm_ch<long double>); }
+void kernels::th(const long double* x, long double* y, size_t n, Accuracy) { libm(x, y, n, libm_th<long double>); }
+void kernels::cth(const long double* x, long double* y, size_t n, Accuracy) { libm(x, y, n, libm_cth<long double>); }
+void kernels::exp(const long double* x, long double* y, size_t n, Accuracy) { libm(x, y, n, libm_exp<long double>); }
+void kernels::sqrt(const long double* x, long double* y, size_t n, Accuracy) { libm(x, y, n, libm_sqrt<long double>); }
+
+
+void kernels::pow(const long double* x, const long double* b, long double* y, size_t n, Accuracy) {
+	for (size_t i = 0; i < n; i++) y[i] = std::pow(x[i], b[i]);
+}
\ No newline at end of file
@@ -0,0 +1,69 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+
+// width of a kernel block, 4 doubles fill one 256-bit register and so do twice as many floats
+#ifndef KERNEL_LANES
+#define KERNEL_LANES 4
+#endif
+
+namespace calculator {
+	// accuracy of the built-in functions, selectable per session
+	enum Accuracy {
+		libm_a = 0,  // the standard library
+		ulp1_a,      // own kernels within 1 ulp, the standard library where they can't guarantee it
+		ulp4_a,      // own kernels within 4 ulp
+	};
+
+	// built-in functions over arrays, the input and the output may be the same array
+	namespace kernels {
+		template<class T>
+		using Unary = void (*)(const T*, T*, size_t, Accuracy);
+
+		void sin(const double*, double*, size_t, Accuracy);
+		void cos(const double*, double*, size_t, Accuracy);
+		void tg(const double*, double*, size_t, Accuracy);
+		void ctg(const double*, double*, size_t, Accuracy);
+		void sh(const double*, double*, size_t, Accuracy);
+		void ch(const double*, double*, size_t, Accuracy);
+		void th(const double*, double*, size_t, Accuracy);
+		void cth(const double*, double*, size_t, Accuracy);
+		void exp(const double*, double*, size_t, Accuracy);
+		void sqrt(const double*, double*, size_t, Accuracy);
+
+		void pow(const double*, const double*, double*, size_t, Accuracy);
+
+		// the 1 ulp mode rounds the double kernels, the 4 ulp mode has float kernels with twice the lanes
+		void sin(const float*, float*, size_t, Accuracy);
+		void cos(const float*, float*, size_t, Accuracy);
+		void tg(const float*, float*, size_t, Accuracy);
+		void ctg(const float*, float*, size_t, Accuracy);
+		void sh(const float*, float*, size_t, Accuracy);
+		void ch(const float*, float*, size_t, Accuracy);
+		void th(const float*, float*, size_t, Accuracy);
+		void cth(const float*, float*, size_t, Accuracy);
+		void exp(const float*, float*, size_t, Accuracy);
+		void sqrt(const float*, float*, size_t, Accuracy);
+
+		void pow(const float*, const float*, float*, size_t, Accuracy);
+
+		// the standard library in every mode, so the precision is kept
+		void sin(const long double*, long double*, size_t, Accuracy);
+		void cos(const long double*, long double*, size_t, Accuracy);
+		void tg(const long double*, long double*, size_t, Accuracy);
+		void ctg(const long double*, long double*, size_t, Accuracy);
+		void sh(const long double*, long double*, size_t, Accuracy);
+		void ch(const long double*, long double*, size_t, Accuracy);
+		void th(const long double*, long double*, size_t, Accuracy);
+		void cth(const long double*, long double*, size_t, Accuracy);
+		void exp(const long double*, long double*, size_t, Accuracy);
+		void sqrt(const long double*, long double*, size_t, Accuracy);
+
+		void pow(const long double*, const long double*, long double*, size_t, Accuracy);
+	};
+};
\ No newline at end of file
@@ -114,12 +114,13 @@ LRESULT CALLBACK WndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam)
                 std::wstring wstr(begin, lstrlen(begin));
 
                 if (wstr.size() > 0) {
-                    try {
-                        auto res = evaluate(std::string(wstr.begin(), wstr.end()), globals);
-                        wstr = wstr = L"\r\n    = " + std::wstring(res.begin(), res.end()) + L"\r\n";
+                    auto res = evaluate(std::string(wstr.begin(), wstr.end()), globals);
+                    if (res) {
+                        auto& str = res.value();
+                        wstr = L"\r\n    = " + std::wstring(str.begin(), str.end()) + L"\r\n";
                     }
-                    catch (const std::exception& err) {
-                        std::string str(err.what());
+                    else {
+                        auto& str = res.error().what;
                         wstr = L"\r\n    " + std::wstring(str.begin(), str.end()) + L"\r\n";
                     }
                     addText(hWndDisplay, wstr.c_str());
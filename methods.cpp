@@ -0,0 +1,240 @@
+#include "methods.h"
+
+
+using namespace calculator;
+
+
+//------------------------------------------ integrate ------------------------------------------
+// 15-point Kronrod rule with the embedded 7-point Gauss rule, the error is their difference
+
+static const double xgk[8] = {
+	0.991455371120812639206854697526329, 0.949107912342758524526189684047851,
+	0.864864423359769072789712788640926, 0.741531185599394439863864773280788,
+	0.586087235467691130294144845693013, 0.405845151377397166906606412076961,
+	0.207784955007898467600689403773245, 0.000000000000000000000000000000000,
+};
+
+static const double wgk[8] = {
+	0.022935322010529224963732008058970, 0.063092092629978553290700663189204,
+	0.104790010322250183839876322541518, 0.140653259715525918745189590510238,
+	0.169004726639267902826583426598550, 0.190350578064785409913256402421014,
+	0.204432940075298892414161999234649, 0.209482141084727828012999174891714,
+};
+
+// weights of the Gauss nodes xgk[1], xgk[3], xgk[5], xgk[7]
+static const double wg[4] = {
+	0.129484966168869693270611432679082, 0.279705391489276667901467771423780,
+	0.381830050505118944950369775488975, 0.417959183673469387755102040816327,
+};
+
+struct Interval {
+	double a, b;
+	double value, error, modulus;
+};
+
+
+static void nodes(double a, double b, double* x) {
+	double center = (a + b) / 2, half = (b - a) / 2;
+	for (int i = 0; i < 7; i++) {
+		x[i] = center - half * xgk[i];
+		x[14 - i] = center + half * xgk[i];
+	}
+	x[7] = center;
+}
+
+
+static Interval rule(double a, double b, const double* y) {
+	double half = (b - a) / 2;
+	double kronrod = wgk[7] * y[7], gauss = wg[3] * y[7], modulus = wgk[7] * std::fabs(y[7]);
+
+	for (int i = 0; i < 7; i++) {
+		double sum = y[i] + y[14 - i];
+		kronrod += wgk[i] * sum;
+		modulus += wgk[i] * (std::fabs(y[i]) + std::fabs(y[14 - i]));
+		if (i & 1) gauss += wg[i / 2] * sum;
+	}
+	return { a, b, kronrod * half, std::fabs((kronrod - gauss) * half), modulus * std::fabs(half) };
+}
+
+
+// every interval gets a share of the tolerance by its width, the ones above it are halved
+bool methods::integrate(const Batch& fn, double a, double b, double& res) {
+	std::vector<Interval> intervals, next;
+	std::vector<double> x(15), y(15);
+	std::vector<char> halved;
+
+	nodes(a, b, x.data());
+	if (!fn(x.data(), y.data(), x.size())) return false;
+	intervals.push_back(rule(a, b, y.data()));
+
+	while (true) {
+		double error = 0, modulus = 0;
+		res = 0;
+		for (auto& interval : intervals) {
+			res += interval.value;
+			error += interval.error;
+			modulus += interval.modulus;
+		}
+
+		// an infinite or NaN error never gets below the tolerance
+		auto tolerance = INTEGRATE_TOLERANCE * modulus;
+		if (!std::isfinite(error)) return false;
+		if (error <= tolerance) return true;
+		if (intervals.size() >= INTEGRATE_MAX_INTERVALS) return false;
+
+		x.clear();
+		halved.assign(intervals.size(), false);
+		for (size_t i = 0; i < intervals.size(); i++) {
+			auto& interval = intervals[i];
+			double center = (interval.a + interval.b) / 2;
+			if (interval.error <= tolerance * std::fabs((interval.b - interval.a) / (b - a)) ||
+				center == interval.a || center == interval.b) continue;
+
+			halved[i] = true;
+			x.resize(x.size() + 30);
+			nodes(interval.a, center, &x[x.size() - 30]);
+			nodes(center, interval.b, &x[x.size() - 15]);
+		}
+		// too narrow to be halved
+		if (x.empty()) return false;
+
+		y.resize(x.size());
+		if (!fn(x.data(), y.data(), x.size())) return false;
+
+		next.clear();
+		size_t node = 0;
+		for (size_t i = 0; i < intervals.size(); i++) {
+			auto& interval = intervals[i];
+			double center = (interval.a + interval.b) / 2;
+			if (halved[i]) {
+				next.push_back(rule(interval.a, center, &y[node]));
+				next.push_back(rule(center, interval.b, &y[node + 15]));
+				node += 30;
+			}
+			else next.push_back(interval);
+		}
+		std::swap(intervals, next);
+	}
+}
+
+
+//-------------------------------------------- solve --------------------------------------------
+
+static bool opposite(double a, double b) {
+	return (a < 0 && b > 0) || (a > 0 && b < 0);
+}
+
+
+// Brent's method on [a, b] with f(a) and f(b) of opposite signs
+static bool brent(const methods::Batch& fn, double a, double fa, double b, double fb, double& res) {
+	double c = a, fc = fa;
+
+	for (size_t iter = 0; iter < SOLVE_MAX_ITERATIONS; iter++) {
+		double prev = b - a;
+		if (std::fabs(fc) < std::fabs(fb)) {
+			a = b; b = c; c = a;
+			fa = fb; fb = fc; fc = fa;
+		}
+
+		double tolerance = 2 * DBL_EPSILON * std::fabs(b) + DBL_MIN;
+		double step = (c - b) / 2;
+		if (std::fabs(step) <= tolerance || fb == 0) {
+			res = b;
+			return true;
+		}
+
+		// secant or inverse quadratic interpolation while it converges faster than bisection
+		if (std::fabs(prev) >= tolerance && std::fabs(fa) > std::fabs(fb)) {
+			double p, q, cb = c - b, t = fb / fa;
+			if (a == c) {
+				p = cb * t;
+				q = 1 - t;
+			}
+			else {
+				double r = fb / fc;
+				q = fa / fc;
+				p = t * (cb * q * (q - r) - (b - a) * (r - 1));
+				q = (q - 1) * (r - 1) * (t - 1);
+			}
+			if (p > 0) q = -q;
+			else p = -p;
+
+			if (p < 0.75 * cb * q - std::fabs(tolerance * q) / 2 && p < std::fabs(prev * q / 2))
+				step = p / q;
+		}
+		if (std::fabs(step) < tolerance) step = (step > 0) ? tolerance : -tolerance;
+
+		a = b;
+		fa = fb;
+		b += step;
+		if (!fn(&b, &fb, 1)) return false;
+		if (!opposite(fb, fc) && fb != 0) {
+			c = a;
+			fc = fa;
+		}
+	}
+	return false;
+}
+
+
+// points on both sides at doubling distances are evaluated in one batch,
+// the nearest sign change is the bracket
+static bool bracket(const methods::Batch& fn, double x0, double f0, double& res) {
+	const size_t steps = 0x40;
+	double step = 1e-3 * std::max(std::fabs(x0), 1.0);
+
+	std::vector<double> x(2 * steps), y(2 * steps);
+	for (size_t i = 0; i < steps; i++) {
+		x[2 * i] = x0 + step;
+		x[2 * i + 1] = x0 - step;
+		step *= 2;
+	}
+	if (!fn(x.data(), y.data(), x.size())) return false;
+
+	for (size_t i = 0; i < x.size(); i++) {
+		auto prev = (i < 2) ? x0 : x[i - 2];
+		auto fprev = (i < 2) ? f0 : y[i - 2];
+		if (y[i] == 0) {
+			res = x[i];
+			return true;
+		}
+		if (opposite(fprev, y[i])) return brent(fn, prev, fprev, x[i], y[i], res);
+	}
+	return false;
+}
+
+
+// the derivative is a central difference, its points are evaluated together with the iterate;
+// when a step doesn't decrease |f| the bracket is searched around the best point
+bool methods::solve(const Batch& fn, double x0, double& res) {
+	double x = x0, best = x0, fbest = HUGE_VAL, prev = x0, fprev = 0;
+
+	for (size_t iter = 0; iter < SOLVE_MAX_ITERATIONS; iter++) {
+		double h = std::cbrt(DBL_EPSILON) * (x ? std::fabs(x) : 1.0);
+		double in[3] = { x, x + h, x - h }, out[3];
+		if (!fn(in, out, 3)) return false;
+
+		if (out[0] == 0) {
+			res = x;
+			return true;
+		}
+		if (iter && opposite(fprev, out[0])) return brent(fn, prev, fprev, x, out[0], res);
+		if (!(std::fabs(out[0]) < std::fabs(fbest))) break;
+
+		best = x;
+		fbest = out[0];
+		double step = out[0] * (in[1] - in[2]) / (out[1] - out[2]);
+		if (!std::isfinite(step)) break;
+
+		prev = x;
+		fprev = out[0];
+		x -= step;
+		if (std::fabs(step) <= 4 * DBL_EPSILON * std::max(std::fabs(prev), DBL_EPSILON * std::fabs(x0))) {
+			res = x;
+			return true;
+		}
+	}
+
+	if (!std::isfinite(fbest)) return false;
+	return bracket(fn, best, fbest, res);
+}
\ No newline at end of file
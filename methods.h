@@ -0,0 +1,34 @@
+#pragma once
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+// error of an integral relative to the integral of the absolute value
+#ifndef INTEGRATE_TOLERANCE
+#define INTEGRATE_TOLERANCE 1e-10
+#endif
+
+#ifndef INTEGRATE_MAX_INTERVALS
+#define INTEGRATE_MAX_INTERVALS 0x400
+#endif
+
+#ifndef SOLVE_MAX_ITERATIONS
+#define SOLVE_MAX_ITERATIONS 0x100
+#endif
+
+namespace calculator {
+	// numerical methods over a function of one argument
+	namespace methods {
+		// values of the function at n points, false stops the method
+		typedef std::function<bool(const double*, double*, size_t)> Batch;
+
+		// adaptive Gauss-Kronrod, all the intervals of a round are evaluated in one batch
+		bool integrate(const Batch&, double, double, double&);
+
+		// safeguarded Newton from the given point, Brent's method once a root is bracketed
+		bool solve(const Batch&, double, double&);
+	};
+};
\ No newline at end of file
@@ -0,0 +1,129 @@
+#include "pool.h"
+
+
+using namespace calculator;
+
+
+Pool::Pool(size_t size) {
+	for (size_t i = 0; i <= size; i++)
+		queues.emplace_back(new Queue);
+	for (size_t i = 0; i < size; i++)
+		workers.emplace_back(&Pool::work, this, i);
+}
+
+
+Pool::~Pool() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stop = true;
+	}
+	wakeup.notify_all();
+	for (auto& worker : workers) worker.join();
+}
+
+
+size_t Pool::size() const noexcept {
+	return workers.size();
+}
+
+
+size_t Pool::jobs() const noexcept {
+	return runs.load();
+}
+
+
+void Pool::run(size_t n, const std::function<void(size_t)>& fn) {
+	runs++;
+	Job job;
+	job.fn = &fn;
+	job.left = n;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		pending += n;
+	}
+
+	// the last queue belongs to the callers, the tasks that couldn't be queued are done
+	size_t queued = 0;
+	try {
+		for (; queued < n; queued++) {
+			auto& queue = *queues[queued % queues.size()];
+			std::lock_guard<std::mutex> lock(queue.mutex);
+			queue.tasks.push_back({ &job, queued });
+		}
+	}
+	catch (...) {
+		pending -= n - queued;
+		std::lock_guard<std::mutex> lock(job.mutex);
+		if (!job.error) job.error = std::current_exception();
+		job.left -= n - queued;
+	}
+	wakeup.notify_all();
+
+	// the queued tasks point at the job, so it is waited for even after a failure;
+	// once the queues are empty the rest of it is running on the workers
+	Task task;
+	while (take(queues.size() - 1, task)) execute(task);
+
+	std::unique_lock<std::mutex> lock(job.mutex);
+	job.finished.wait(lock, [&job] { return !job.left; });
+	if (job.error) std::rethrow_exception(job.error);
+}
+
+
+Pool& Pool::shared() {
+	static Pool pool(POOL_WORKERS);
+	return pool;
+}
+
+
+// own queue first, then the others starting from the next one
+bool Pool::take(size_t self, Task& task) {
+	for (size_t i = 0; i < queues.size(); i++) {
+		auto& queue = *queues[(self + i) % queues.size()];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		if (queue.tasks.empty()) continue;
+
+		if (i == 0) {
+			task = queue.tasks.back();
+			queue.tasks.pop_back();
+		}
+		else {
+			task = queue.tasks.front();
+			queue.tasks.pop_front();
+		}
+		pending--;
+		return true;
+	}
+	return false;
+}
+
+
+void Pool::work(size_t self) {
+	Task task;
+	while (true) {
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			wakeup.wait(lock, [this] { return stop || pending.load(); });
+			if (stop) return;
+		}
+		while (take(self, task)) execute(task);
+	}
+}
+
+
+// an exception is kept for the caller of run, the caller sees the last task counted only
+// after the mutex is released, so the job isn't touched after that
+void Pool::execute(const Task& task) {
+	std::exception_ptr error;
+	try {
+		(*task.job->fn)(task.index);
+	}
+	catch (...) {
+		error = std::current_exception();
+	}
+
+	auto& job = *task.job;
+	std::lock_guard<std::mutex> lock(job.mutex);
+	if (error && !job.error) job.error = error;
+	if (!--job.left) job.finished.notify_all();
+}
\ No newline at end of file
@@ -0,0 +1,75 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// workers of the shared pool, one less than the hardware threads by default
+#ifndef POOL_WORKERS
+#define POOL_WORKERS (std::max(std::thread::hardware_concurrency(), 1u) - 1)
+#endif
+
+namespace calculator {
+	// work-stealing pool: every worker takes tasks from the back of its own queue
+	// and steals from the front of the others when its queue is empty
+	class Pool {
+	public:
+		explicit Pool(size_t);
+		~Pool();
+
+		Pool(const Pool&) = delete;
+		Pool& operator=(const Pool&) = delete;
+
+		size_t size() const noexcept;
+
+		// calls of run so far, so a caller can tell whether a computation was split
+		size_t jobs() const noexcept;
+
+		// calls fn(i) for every i < n and returns when all of them are done,
+		// the calling thread executes tasks too; the first exception of fn is rethrown
+		// once every task has finished
+		void run(size_t, const std::function<void(size_t)>&);
+
+		// POOL_WORKERS workers, the caller is the last one
+		static Pool& shared();
+
+	private:
+		// one call of run, it lives on the stack of the caller; left and error are guarded by the mutex,
+		// the last task wakes the caller
+		struct Job {
+			const std::function<void(size_t)>* fn;
+			size_t left;
+			std::mutex mutex;
+			std::condition_variable finished;
+			std::exception_ptr error;
+		};
+
+		struct Task {
+			Job* job;
+			size_t index;
+		};
+
+		struct Queue {
+			std::mutex mutex;
+			std::deque<Task> tasks;
+		};
+
+		std::vector<std::unique_ptr<Queue>> queues;
+		std::vector<std::thread> workers;
+		std::mutex mutex;
+		std::condition_variable wakeup;
+		std::atomic<size_t> pending{ 0 };
+		std::atomic<size_t> runs{ 0 };
+		bool stop = false;
+
+		bool take(size_t, Task&);
+		void work(size_t);
+		static void execute(const Task&);
+	};
+};
\ No newline at end of file
@@ -0,0 +1,141 @@
+// error and throughput of the block kernels of double and float in every accuracy mode, the reference
+// is the long double standard library, so the errors mean something only where it is wider than double
+#include "test.h"
+#include <limits>
+
+
+struct Case {
+	const char* name;
+	kernels::Unary<double> fn;
+	kernels::Unary<float> fnf;
+	long double (*ref)(long double);
+	double low, high;
+};
+
+
+static const Case cases[] = {
+	{ "sin", kernels::sin, kernels::sin, [](long double x) { return std::sin(x); }, -100, 100 },
+	{ "sin big", kernels::sin, kernels::sin, [](long double x) { return std::sin(x); }, -8e5, 8e5 },
+	{ "cos", kernels::cos, kernels::cos, [](long double x) { return std::cos(x); }, -100, 100 },
+	{ "tg", kernels::tg, kernels::tg, [](long double x) { return std::tan(x); }, -100, 100 },
+	{ "ctg", kernels::ctg, kernels::ctg, [](long double x) { return 1 / std::tan(x); }, -100, 100 },
+	{ "exp", kernels::exp, kernels::exp, [](long double x) { return std::exp(x); }, -700, 700 },
+	{ "exp float", kernels::exp, kernels::exp, [](long double x) { return std::exp(x); }, -87, 87 },
+	{ "exp small", kernels::exp, kernels::exp, [](long double x) { return std::exp(x); }, -1, 1 },
+	{ "sh", kernels::sh, kernels::sh, [](long double x) { return std::sinh(x); }, -20, 20 },
+	{ "sh small", kernels::sh, kernels::sh, [](long double x) { return std::sinh(x); }, -1.5, 1.5 },
+	{ "sh big", kernels::sh, kernels::sh, [](long double x) { return std::sinh(x); }, -700, 700 },
+	{ "ch", kernels::ch, kernels::ch, [](long double x) { return std::cosh(x); }, -20, 20 },
+	{ "ch big", kernels::ch, kernels::ch, [](long double x) { return std::cosh(x); }, -700, 700 },
+	{ "th", kernels::th, kernels::th, [](long double x) { return std::tanh(x); }, -3, 3 },
+	{ "th wide", kernels::th, kernels::th, [](long double x) { return std::tanh(x); }, -25, 25 },
+	{ "cth", kernels::cth, kernels::cth, [](long double x) { return 1 / std::tanh(x); }, -3, 3 },
+	{ "cth small", kernels::cth, kernels::cth, [](long double x) { return 1 / std::tanh(x); }, -0.01, 0.01 },
+	{ "sqrt", kernels::sqrt, kernels::sqrt, [](long double x) { return std::sqrt(x); }, 0, 1e6 },
+};
+
+// the kernel of the scalar type
+static void choose(const Case& c, kernels::Unary<double>& fn) { fn = c.fn; }
+static void choose(const Case& c, kernels::Unary<float>& fn) { fn = c.fnf; }
+
+
+template<class T>
+static double ulp(T y, long double ref) {
+	T r = (T)ref;
+	if (std::isnan(y) && std::isnan(r)) return 0;
+	if (std::isinf(r)) return y == r ? 0 : HUGE_VAL;
+	T spacing = r ? std::nextafter(std::fabs(r), (T)HUGE_VAL) - std::fabs(r) : std::numeric_limits<T>::denorm_min();
+	return (double)(std::fabs(y - ref) / spacing);
+}
+
+
+// best of three runs
+template<class Fn>
+static double speed(size_t n, Fn fn) {
+	double best = HUGE_VAL;
+	for (int run = 0; run < 3; run++) {
+		auto start = std::chrono::steady_clock::now();
+		fn();
+		best = std::min(best, seconds(start));
+	}
+	return n / best / 1e6;
+}
+
+
+// a value must not depend on its position in the array, so every result is compared
+// with the one of a single value
+template<class T>
+static void bounded(const char* name, Accuracy mode, double err, double bound, const std::vector<T>& y, const std::vector<T>& one) {
+	char text[128];
+	std::snprintf(text, sizeof(text), "%s %s in the %s mode: %.3f ulp, bound %.0f%s", name,
+		sizeof(T) == sizeof(float) ? "float" : "double", mode_names[mode], err, bound, y == one ? "" : ", depends on the position");
+	check(text, err <= bound && y == one, true);
+}
+
+
+template<class T>
+static void measure(size_t n, std::mt19937_64& rng) {
+	std::vector<T> x(n), b(n), y(n), one(n);
+
+	std::printf("%-16s", sizeof(T) == sizeof(float) ? "float" : "double");
+	for (auto name : mode_names) std::printf(" | %-6s ulp  Mval/s", name);
+	std::printf("\n");
+
+	for (auto& c : cases) {
+		kernels::Unary<T> fn = nullptr;
+		choose(c, fn);
+		std::uniform_real_distribution<T> dist((T)c.low, (T)c.high);
+		for (auto& v : x) v = dist(rng);
+
+		std::printf("%-16s", c.name);
+		for (auto mode : modes) {
+			auto rate = speed(n, [&]() { fn(x.data(), y.data(), n, mode); });
+			for (size_t i = 0; i < n; i++) fn(&x[i], &one[i], 1, mode);
+
+			double err = 0;
+			for (size_t i = 0; i < n; i++) err = std::max(err, ulp(y[i], c.ref(x[i])));
+			std::printf(" | %10.3f %8.1f", err, rate);
+
+			if (mode != libm_a) bounded(c.name, mode, err, mode == ulp1_a ? 1 : 4, y, one);
+		}
+		std::printf("\n");
+	}
+
+	// integer exponents, the 1 ulp mode has own kernels for -1..2 only and takes the rest from the standard library;
+	// the wide bases are +-10^k with x^4 and x^-4 beyond the range and down to the subnormals
+	const double wide = sizeof(T) == sizeof(float) ? 12 : 100;
+	std::uniform_real_distribution<double> base(-10, 10), power(-wide, wide);
+	for (int low : { -4, -1 })
+	for (bool big : { false, true }) {
+		int high = low == -4 ? 4 : 2;
+		for (size_t i = 0; i < n; i++) {
+			x[i] = big ? (T)std::copysign(std::pow(10.0, power(rng)), base(rng)) : (T)base(rng);
+			b[i] = (T)(low + (int)(rng() % (high - low + 1)));
+		}
+
+		char name[24];
+		std::snprintf(name, sizeof(name), "pow %d..%d%s", low, high, big ? " wide" : "");
+		std::printf("%-16s", name);
+		for (auto mode : modes) {
+			auto rate = speed(n, [&]() { kernels::pow(x.data(), b.data(), y.data(), n, mode); });
+			for (size_t i = 0; i < n; i++) kernels::pow(&x[i], &b[i], &one[i], 1, mode);
+
+			double err = 0;
+			for (size_t i = 0; i < n; i++) err = std::max(err, ulp(y[i], std::pow((long double)x[i], (long double)b[i])));
+			std::printf(" | %10.3f %8.1f", err, rate);
+
+			if (mode != libm_a) bounded("pow", mode, err, mode == ulp1_a ? 1 : 4, y, one);
+		}
+		std::printf("\n");
+	}
+}
+
+
+int main() {
+	const size_t n = 1 << 20;
+	std::mt19937_64 rng(7);
+
+	measure<double>(n, rng);
+	measure<float>(n, rng);
+	return finish();
+}
\ No newline at end of file
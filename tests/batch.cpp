@@ -0,0 +1,50 @@
+// calc_batch against calc point by point: the same values in every accuracy mode and the speed-up
+#include "test.h"
+
+
+static const char* lines[] = {
+	"sin(x) + cos(y)",
+	"exp(-x^2) * sqrt(y^2 + 1)",
+	"sh(x) / ch(y) + th(x * y) - cth(y + 3)",
+	"tg(x) * ctg(y + 0.5) + x^3 - y^-2",
+	"g(x, y) + g(y, x) / 2",
+	"k * x + 2(x - y)(x + y)",
+	"(z = x + y) + z",
+};
+
+
+int main() {
+	const size_t n = 1 << 16;
+	std::vector<double> x(n), y(n);
+	std::mt19937_64 rng(3);
+	std::uniform_real_distribution<double> dist(-3, 3);
+	for (size_t i = 0; i < n; i++) {
+		x[i] = dist(rng);
+		y[i] = dist(rng);
+	}
+
+	for (auto mode : modes) {
+		Definition globals;
+		globals.accuracy = mode;
+		evaluate("g(a, b) = sin(a) * exp(b / 4)", globals);
+		evaluate("k = 0.25", globals);
+
+		for (auto line : lines) {
+			auto expr = compiled(line, { "x", "y" });
+
+			auto start = std::chrono::steady_clock::now();
+			auto res = calc_batch(expr, { x.data(), y.data() }, n, globals);
+			double batch = seconds(start);
+
+			start = std::chrono::steady_clock::now();
+			bool ok = matches(res, expr, { x.data(), y.data() }, n, globals);
+			double single = seconds(start);
+
+			char name[128];
+			std::snprintf(name, sizeof(name), "%-5s  %-42s %7.1f Mval/s, %5.1fx calc", mode_names[mode], line,
+				n / batch / 1e6, single / batch);
+			check(name, ok);
+		}
+	}
+	return finish();
+}
\ No newline at end of file
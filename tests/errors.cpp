@@ -0,0 +1,127 @@
+// the code and the position of every class of errors, and the Result path against the former one
+// that threw the error and wrote it out, on a corpus with a fifth of the lines malformed
+#include "test.h"
+#include <fstream>
+#include <stdexcept>
+
+
+struct Case {
+	const char* line;
+	Error::Code code;
+	size_t pos;
+};
+
+
+static const Case cases[] = {
+	{ "2 + \x7f", Error::invalid_symbol_e, 4 },
+	{ "2 # 3", Error::unknown_token_e, 2 },
+	{ "1 + .", Error::unknown_token_e, 4 },
+	{ "1 + (2 * 3", Error::invalid_expression_e, 4 },
+	{ "(1 + 2))", Error::invalid_expression_e, 7 },
+	{ "2 +", Error::invalid_expression_e, 3 },
+	{ "2, 3", Error::invalid_expression_e, 1 },
+	{ "   ", Error::empty_expression_e, 0 },
+	{ "1 + sin()", Error::empty_argument_e, 4 },
+	{ "f(1, )", Error::empty_argument_e, 5 },
+	{ "1 + y", Error::undefined_variable_e, 4 },
+	{ "2 * u(1)", Error::undefined_function_e, 4 },
+	{ "* 2", Error::invalid_operation_e, 0 },
+	{ "1 = 2", Error::invalid_assignment_e, 2 },
+	{ "g(x) = (1, 2)", Error::invalid_expression_e, 9 },
+	{ "g(x, ) = x", Error::invalid_expression_e, 5 },
+	// errors inside a body are reported where it is used
+	{ "1 + bad(2)", Error::undefined_variable_e, 4 },
+	{ "3 * deep(1)", Error::recursion_limit_e, 4 },
+	{ "integrate(q, -1, 1)", Error::no_convergence_e, 0 },
+	{ "solve(y, 1)", Error::undefined_function_e, 6 },
+};
+
+
+static void classes() {
+	Definition globals;
+	evaluate("f(a, b) = a + b", globals);
+	evaluate("bad(x) = x + y", globals);
+	evaluate("deep(x) = deep(x)", globals);
+	evaluate("q(x) = 1 / x", globals);
+
+	for (auto& test : cases) {
+		auto res = evaluate(test.line, globals);
+		char name[128];
+		std::snprintf(name, sizeof(name), "%-20s code %2d at %zu: %s", test.line, (int)res.error().code, res.error().pos,
+			res.error().what.c_str());
+		check(name, !res && res.error().code == test.code && res.error().pos == test.pos);
+	}
+
+	// the limit is checked before the expression is evaluated
+	for (size_t i = 0; i <= MAX_DEFINITIONS_SIZE; i++)
+		evaluate("v" + std::to_string(i) + " = 1", globals);
+	auto res = evaluate("1 + 1", globals);
+	check("too many definitions give definition_limit_e", !res && res.error().code == Error::definition_limit_e);
+}
+
+
+// what evaluate did before: an error was thrown where it was found, caught in evaluate,
+// written out with std::endl and returned as the text of the result
+static std::string thrown(const std::string& line, Definition& globals, std::ostream& out) {
+	try {
+		auto res = evaluate(line, globals);
+		if (!res) throw std::invalid_argument(res.error().what);
+		return res.value();
+	}
+	catch (const std::exception& err) {
+		out << err.what() << std::endl;
+		return err.what();
+	}
+}
+
+
+// microseconds per line of both paths
+static void timed(const char* name, const std::vector<std::string>& lines, Definition& globals) {
+	std::ofstream null("/dev/null");
+	size_t errors = 0;
+	auto start = std::chrono::steady_clock::now();
+	for (auto& line : lines) errors += !evaluate(line, globals);
+	double result = seconds(start) / lines.size();
+
+	start = std::chrono::steady_clock::now();
+	for (auto& line : lines) thrown(line, globals, null);
+	double exception = seconds(start) / lines.size();
+
+	bool same = true;
+	for (size_t i = 0; i < lines.size(); i += 101) {
+		auto res = evaluate(lines[i], globals);
+		same &= (res ? res.value() : res.error().what) == thrown(lines[i], globals, null);
+	}
+	check(std::string(name) + ": both paths give the same text", same);
+	std::printf("     %zu lines, %zu malformed: %.2f us per line with Result, %.2f us thrown and written out\n",
+		lines.size(), errors, 1e6 * result, 1e6 * exception);
+}
+
+
+static void corpus() {
+	const size_t n = 50000;
+	std::mt19937_64 rng(5);
+	std::vector<std::string> mixed, malformed;
+	for (size_t i = 0; i < n; i++) {
+		malformed.push_back(cases[rng() % (sizeof(cases) / sizeof(cases[0]))].line);
+		if (rng() % 5 == 0) mixed.push_back(malformed.back());
+		else mixed.push_back(std::to_string(rng() % 100) + " * sin(" + std::to_string(rng() % 7) + ") + f(2, " +
+			std::to_string(rng() % 9) + ") / 3");
+	}
+
+	Definition globals;
+	evaluate("f(a, b) = a + b", globals);
+	evaluate("bad(x) = x + y", globals);
+	evaluate("deep(x) = deep(x)", globals);
+	evaluate("q(x) = 1 / x", globals);
+
+	timed("mixed", mixed, globals);
+	timed("malformed", malformed, globals);
+}
+
+
+int main() {
+	classes();
+	corpus();
+	return finish();
+}
\ No newline at end of file
@@ -0,0 +1,150 @@
+// export_header in two stages: this program writes formulas.h into the working directory and checks
+// the names it rejects, built with -DEXPORTED it includes the header, which must compile without
+// unused parameters, and compares every exported function and its array overload with calc on random inputs
+#include "test.h"
+#include <cstring>
+#include <fstream>
+
+#ifdef EXPORTED
+#pragma GCC diagnostic push
+#pragma GCC diagnostic error "-Wunused-parameter"
+#include "formulas.h"
+#pragma GCC diagnostic pop
+#endif
+
+
+// functions used by name read the arguments of their caller, "r" reads only the last one; "c" is a function
+// with a constant body, and a call may pass fewer arguments than are declared when the rest aren't read, or more
+static const char* lines[] = {
+	"k = 2.5",
+	"big = 1 / 0",
+	"n = -3",
+	"z() = 3",
+	"f(x) = sin(x) * exp(-x)",
+	"g(x, y) = x^y + f(x) * k",
+	"h(x) = g(x, 2) - ctg(x) + cth(x)",
+	"u(a) = f * 2 + sqrt(a)",
+	"w(a, b, c) = tg(a) - b / c + sh(a) * ch(b) - th(c)",
+	"v(x) = h(x) + w(x, x, 1) + z() + u(x) + k(7) + big * 0 + n",
+	"e(x) = 2x^-2 + 7",
+	"p(x, a) = x",
+	"q(x) = p(x) + p(x, 3)",
+	"r(u, v, w) = w",
+	"s(a, b, c) = r + a",
+	"m(x) = x^(x - x + 2) + x^(x - x - 1)",
+	"c(x) = 5",
+	"o(x) = c(x) + c() + z(x) + q(x, 1) + c",
+};
+
+
+#ifndef EXPORTED
+
+static void written(const Definition& globals) {
+	auto header = export_header(globals);
+	check("the session is exported", (bool)header);
+	if (!header) return;
+
+	auto& text = header.value();
+	check("unread parameters are unnamed", text.find("inline double r(double, double, double _2)") != std::string::npos);
+	check("a function used by name gets only the read arguments", text.find("r(0.0, 0.0, _2)") != std::string::npos);
+	check("a constant body keeps the parameters", text.find("inline double c(double)") != std::string::npos);
+	check("a call passes the declared arguments", text.find("c(0.0)") != std::string::npos &&
+		text.find("z()") != std::string::npos && text.find("q(_0)") != std::string::npos);
+	check("formulas.h is written", (bool)(std::ofstream("formulas.h") << text));
+}
+
+
+// C++20 keywords, the macros of -std=gnu++ and the names the generated code relies on can't be exported
+static void rejected() {
+	Definition unread;
+	evaluate("r(u, v, w) = w", unread);
+	evaluate("s(a) = r", unread);
+	check("a function used by name can't read more arguments than its caller has", !export_header(unread));
+
+	for (auto name : { "concept", "requires", "consteval", "constinit", "NULL", "NAN", "errno", "unix", "linux", "i386", "std",
+		"char16" }) {
+		Definition globals;
+		evaluate(std::string(name) + " = 1", globals);
+		bool ok = (bool)export_header(globals) == !std::strcmp(name, "char16");
+		check(std::string(name) + (ok ? " is handled" : " is mishandled"), ok);
+	}
+}
+
+
+int main() {
+	Definition globals;
+	for (auto line : lines)
+		check(line, (bool)evaluate(line, globals));
+
+	written(globals);
+	rejected();
+	return finish();
+}
+
+#else
+
+struct Function {
+	const char* name;
+	size_t argc;
+	double (*scalar)(const double*);
+	void (*array)(const double* const*, double*, size_t);
+};
+
+
+int main() {
+	Definition globals;
+	for (auto line : lines)
+		evaluate(line, globals);
+
+	using namespace formulas;
+	Function functions[] = {
+		{ "f", 1, [](const double* a) { return f(a[0]); }, [](const double* const* a, double* y, size_t n) { f(a[0], y, n); } },
+		{ "g", 2, [](const double* a) { return g(a[0], a[1]); }, [](const double* const* a, double* y, size_t n) { g(a[0], a[1], y, n); } },
+		{ "h", 1, [](const double* a) { return h(a[0]); }, [](const double* const* a, double* y, size_t n) { h(a[0], y, n); } },
+		{ "u", 1, [](const double* a) { return u(a[0]); }, [](const double* const* a, double* y, size_t n) { u(a[0], y, n); } },
+		{ "w", 3, [](const double* a) { return w(a[0], a[1], a[2]); }, [](const double* const* a, double* y, size_t n) { w(a[0], a[1], a[2], y, n); } },
+		{ "v", 1, [](const double* a) { return v(a[0]); }, [](const double* const* a, double* y, size_t n) { v(a[0], y, n); } },
+		{ "e", 1, [](const double* a) { return e(a[0]); }, [](const double* const* a, double* y, size_t n) { e(a[0], y, n); } },
+		{ "q", 1, [](const double* a) { return q(a[0]); }, [](const double* const* a, double* y, size_t n) { q(a[0], y, n); } },
+		{ "r", 3, [](const double* a) { return r(a[0], a[1], a[2]); }, [](const double* const* a, double* y, size_t n) { r(a[0], a[1], a[2], y, n); } },
+		{ "s", 3, [](const double* a) { return s(a[0], a[1], a[2]); }, [](const double* const* a, double* y, size_t n) { s(a[0], a[1], a[2], y, n); } },
+		{ "m", 1, [](const double* a) { return m(a[0]); }, [](const double* const* a, double* y, size_t n) { m(a[0], y, n); } },
+		{ "z", 0, [](const double*) { return z(); }, [](const double* const*, double* y, size_t n) { z(y, n); } },
+		{ "c", 1, [](const double* a) { return c(a[0]); }, [](const double* const* a, double* y, size_t n) { c(a[0], y, n); } },
+		{ "o", 1, [](const double* a) { return o(a[0]); }, [](const double* const* a, double* y, size_t n) { o(a[0], y, n); } },
+	};
+
+	const size_t n = 0x4000;
+	std::mt19937_64 rng(7);
+	std::uniform_real_distribution<double> dist(-10, 10);
+
+	for (auto& fn : functions) {
+		std::string call = std::string(fn.name) + "(";
+		for (size_t i = 0; i < fn.argc; i++) call += (i ? ", " : "") + std::string(1, (char)('a' + i));
+		auto expr = compiled(call + ")", { "a", "b", "c" });
+
+		std::vector<std::vector<double>> args(fn.argc, std::vector<double>(n));
+		std::vector<const double*> arrays;
+		for (auto& arg : args) {
+			for (auto& x : arg) x = dist(rng);
+			arrays.push_back(arg.data());
+		}
+		std::vector<double> y(n);
+		fn.array(arrays.data(), y.data(), n);
+
+		size_t mismatches = 0;
+		for (size_t i = 0; i < n; i++) {
+			std::vector<double> argv;
+			for (auto& arg : args) argv.push_back(arg[i]);
+			auto res = calc(expr, argv, globals);
+			mismatches += !res || !same(fn.scalar(argv.data()), res.value()) || !same(y[i], res.value());
+		}
+
+		char name[64];
+		std::snprintf(name, sizeof(name), "%s: %zu of %zu values differ from calc", fn.name, mismatches, n);
+		check(name, !mismatches);
+	}
+	return finish();
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,151 @@
+// copy-on-write sessions: a fork and its parent don't see the definitions of each other, a chain
+// deeper than MAX_DEFINITION_LAYERS is squashed with the latest definitions kept, the limit of
+// a session counts only the names it adds; the memory of 10k forks of a 5k-definition base
+#include "test.h"
+#include <atomic>
+#include <new>
+
+
+// requested bytes of the live allocations, each block keeps its size in front of it
+static std::atomic<size_t> allocated{ 0 };
+
+
+void* operator new(size_t size) {
+	auto block = static_cast<size_t*>(std::malloc(size + sizeof(std::max_align_t)));
+	if (!block) throw std::bad_alloc();
+	*block = size;
+	allocated += size;
+	return reinterpret_cast<char*>(block) + sizeof(std::max_align_t);
+}
+
+
+void operator delete(void* ptr) noexcept {
+	if (!ptr) return;
+	auto block = reinterpret_cast<size_t*>(static_cast<char*>(ptr) - sizeof(std::max_align_t));
+	allocated -= *block;
+	std::free(block);
+}
+
+
+static double value(const std::string& line, Definition& globals) {
+	auto res = evaluate(line, globals);
+	return res ? std::strtod(res.value().c_str(), nullptr) : NAN;
+}
+
+
+static void isolation() {
+	Definition base;
+	evaluate("a = 1", base);
+	evaluate("f(x) = x + a", base);
+
+	auto fork = base.fork();
+	evaluate("a = 2", fork);
+	evaluate("b = 3", fork);
+	evaluate("c = 4", base);
+
+	check("a fork sees the definitions of its parent", value("f(1)", fork) == 3);
+	check("the parent doesn't see the overrides of a fork", value("f(1)", base) == 2);
+	check("the parent doesn't see the names added by a fork", !evaluate("b", base));
+	check("a fork doesn't see the later definitions of its parent", !evaluate("c", fork));
+
+	auto second = fork.fork();
+	evaluate("a = 5", second);
+	check("a fork of a fork overrides only for itself", value("a", second) == 5 && value("a", fork) == 2 && value("a", base) == 1);
+
+	base.clear();
+	check("clearing the parent leaves its forks", value("f(1)", fork) == 3 && !evaluate("a", base));
+}
+
+
+// every fork freezes a layer, so the chain is squashed several times
+static void layers() {
+	Definition globals;
+	std::vector<Definition> forks;
+	const size_t n = 4 * MAX_DEFINITION_LAYERS + 3;
+
+	for (size_t i = 0; i < n; i++) {
+		evaluate("v = " + std::to_string(i), globals);
+		evaluate("n" + std::to_string(i) + " = " + std::to_string(i), globals);
+		forks.push_back(globals.fork());
+	}
+
+	bool names = true, kept = true;
+	for (size_t i = 0; i < n; i++) {
+		names &= value("n" + std::to_string(i), globals) == i;
+		kept &= value("v", forks[i]) == i;
+	}
+	check("the latest definition is found after the squashes", value("v", globals) == n - 1);
+	check("every name is found after the squashes", names);
+	check("every fork keeps the value it was forked with", kept);
+	check("names lists every definition once", globals.names().size() == n + 1);
+}
+
+
+static void limit() {
+	Definition base;
+	for (size_t i = 0; i < 2 * MAX_DEFINITIONS_SIZE; i++)
+		evaluate("b" + std::to_string(i) + " = " + std::to_string(i), base);
+
+	auto fork = base.fork();
+	check("a fork adds nothing yet", fork.added() == 0 && fork.size() == base.size());
+
+	evaluate("b0 = 7", fork);
+	check("an override isn't an added name", fork.added() == 0);
+
+	for (size_t i = 0; i < MAX_DEFINITIONS_SIZE; i++)
+		evaluate("n" + std::to_string(i) + " = 1", fork);
+	check("a fork may add up to the limit", value("b0 + n0", fork) == 8);
+
+	evaluate("over = 1", fork);
+	auto res = evaluate("b1", fork);
+	check("one more name reaches the limit", !res && res.error().code == Error::definition_limit_e);
+}
+
+
+// a base of functions, every fork overrides one of them and adds a variable
+static void memory() {
+	const size_t definitions = 5000, forks = 10000;
+
+	auto before = allocated.load();
+	Definition base;
+	for (size_t i = 0; i < definitions; i++)
+		evaluate("f" + std::to_string(i) + "(x) = x * " + std::to_string(i) + " + sin(x) / 2", base);
+	auto base_bytes = allocated - before;
+
+	before = allocated.load();
+	std::vector<Definition> tenants;
+	tenants.reserve(forks);
+	for (size_t i = 0; i < forks; i++) {
+		tenants.push_back(base.fork());
+		evaluate("f" + std::to_string(i % definitions) + "(x) = x", tenants.back());
+		evaluate("t = " + std::to_string(i), tenants.back());
+	}
+	auto fork_bytes = allocated - before;
+
+	bool own = true;
+	for (size_t i = 0; i < forks; i += 97)
+		own &= value("f" + std::to_string(i % definitions) + "(3) + t", tenants[i]) == 3 + i;
+	check("every fork has its own definitions", own);
+
+	// lookups of the base through a fork, its chain has at most MAX_DEFINITION_LAYERS layers
+	size_t found = 0;
+	auto start = std::chrono::steady_clock::now();
+	for (size_t i = 0; i < 1000000; i++)
+		found += (bool)tenants[i % forks].borrow("f" + std::to_string(i % definitions));
+	double lookup = seconds(start) / 1e6;
+	check("every base name is found through a fork", found == 1000000);
+
+	std::printf("     base: %zu definitions, %.1f MB\n", definitions, base_bytes / 1e6);
+	std::printf("     %zu forks: %.1f MB, %.0f bytes per fork, a deep copy each would take %.1f GB\n", forks,
+		fork_bytes / 1e6, (double)fork_bytes / forks, (double)base_bytes * forks / 1e9);
+	std::printf("     lookup through a fork: %.0f ns with the name built\n", lookup * 1e9);
+}
+
+
+int main() {
+	isolation();
+	layers();
+	limit();
+	memory();
+	return finish();
+}
\ No newline at end of file
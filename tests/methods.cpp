@@ -0,0 +1,94 @@
+// integrate and solve: accuracy and evaluations of the built-ins against an external loop
+// that runs the same method through evaluate() point by point, and the argument errors
+#include "test.h"
+
+
+static Result<double> run(const std::string& line, Definition& globals) {
+	auto tokens = read_expr(line);
+	if (!tokens) return tokens.error();
+	auto expr = compile_expr(tokens.value().begin(), tokens.value().end());
+	if (!expr) return expr.error();
+	return calc(expr.value(), {}, globals);
+}
+
+
+struct Case {
+	const char* line;
+	const char* fn;
+	double a, b;
+	double exact;
+};
+
+
+// the built-in evaluates the compiled body in batches, the external loop formats every point
+// into a line and parses the printed result back, so both its precision and speed are lower
+static void accuracy(Definition& globals) {
+	const double pi = 3.141592653589793;
+	Case cases[] = {
+		{ "integrate(f, 0, 3.141592653589793)", "f", 0, pi, (1 + std::exp(-pi)) / 2 },
+		{ "integrate(h, 0, 1)", "h", 0, 1, 2.0 / 3 },
+		{ "integrate(p, 0, 3)", "p", 0, 3, 9 },
+		{ "solve(k, 0)", "k", 0, 0, 0.7390851332151607 },
+		{ "solve(c, 2)", "c", 2, 0, 2.0945514815423265 },
+	};
+
+	std::printf("     %-36s %9s %6s %9s | %9s %6s %9s\n", "", "error", "evals", "Meval/s", "external", "evals", "Meval/s");
+	for (auto& test : cases) {
+		bool integral = test.line[0] == 'i';
+		const size_t rounds = 100;
+		auto start = std::chrono::steady_clock::now();
+		auto res = run(test.line, globals);
+		for (size_t i = 1; i < rounds; i++) run(test.line, globals);
+		double time = seconds(start) / rounds;
+
+		// the same method with a counter, through calc like the built-in
+		size_t evals = 0;
+		auto def = globals.find(test.fn);
+		methods::Batch counting = [&](const double* x, double* y, size_t n) {
+			evals += n;
+			for (size_t i = 0; i < n; i++) y[i] = calc(*def, { x[i] }, globals).value();
+			return true;
+		};
+		double value;
+		integral ? methods::integrate(counting, test.a, test.b, value) : methods::solve(counting, test.a, value);
+
+		size_t external = 0;
+		methods::Batch loop = [&](const double* x, double* y, size_t n) {
+			char line[64];
+			external += n;
+			for (size_t i = 0; i < n; i++) {
+				std::snprintf(line, sizeof(line), "%s(%.17f)", test.fn, x[i]);
+				y[i] = std::stod(evaluate(line, globals).value());
+			}
+			return true;
+		};
+		start = std::chrono::steady_clock::now();
+		double other = 0;
+		bool converged = integral ? methods::integrate(loop, test.a, test.b, other) : methods::solve(loop, test.a, other);
+		double other_time = seconds(start);
+
+		double error = std::fabs(res.value() - test.exact), other_error = std::fabs(other - test.exact);
+		bool ok = res && error <= INTEGRATE_TOLERANCE * std::max(1.0, std::fabs(test.exact)) && (!converged || error <= other_error);
+		char name[128];
+		std::snprintf(name, sizeof(name), "%-36s %9.1e %6zu %9.2f | %9.1e %6zu %9.3f", test.line, error, evals,
+			evals / time / 1e6, other_error, external, external / other_time / 1e6);
+		check(name, ok);
+	}
+}
+
+
+int main() {
+	Definition globals;
+	for (auto line : { "f(x) = sin(x) * exp(-x)", "h(x) = sqrt(x)", "p(x) = x^2", "k(x) = x - cos(x)",
+		"c(x) = x^3 - 2x - 5", "q(x) = 1 / x" })
+		evaluate(line, globals);
+
+	accuracy(globals);
+
+	check("integrate with 4 arguments", run("integrate(p, 0, 1, 2)", globals).error().code == Error::invalid_expression_e);
+	check("solve with 3 arguments", run("solve(k, 0, 1)", globals).error().code == Error::invalid_expression_e);
+	check("integrate with 2 arguments", run("integrate(p, 0)", globals).error().code == Error::empty_argument_e);
+	check("solve without arguments", run("solve()", globals).error().code == Error::empty_argument_e);
+	check("infinite error doesn't converge", run("integrate(q, -1, 1)", globals).error().code == Error::no_convergence_e);
+	return finish();
+}
\ No newline at end of file
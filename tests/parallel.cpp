@@ -0,0 +1,116 @@
+// the pool and the parallel evaluation, exceptions of tasks reach the caller and a split expression
+// gives the sequential result; -DPOOL_WORKERS=n sets the workers, the times are per evaluation
+#include "test.h"
+#include <ctime>
+#include <stdexcept>
+#include <thread>
+
+
+// every task runs even when some of them throw, the first exception is rethrown
+static void exceptions() {
+	Pool pool(3);
+	bool ok = true;
+
+	for (size_t round = 0; round < 1000 && ok; round++) {
+		std::atomic<size_t> calls{ 0 };
+		try {
+			pool.run(64, [&](size_t i) {
+				calls++;
+				if (i % 16 == round % 16) throw std::runtime_error("task");
+			});
+			ok = false;
+		}
+		catch (const std::runtime_error&) {
+			ok = calls == 64;
+		}
+	}
+	check("exceptions of tasks reach the caller after every task is done", ok);
+
+	std::atomic<size_t> sum{ 0 };
+	pool.run(1000, [&](size_t i) { sum += i; });
+	check("the pool works after exceptions", sum == 999 * 1000 / 2);
+}
+
+
+// a caller whose tasks run on the workers waits for them without taking a core, the process time
+// stays far below the wall time of the sleeping tasks; the last task is in the queue of the caller,
+// it holds the caller until the workers have taken the others
+static void waiting() {
+	Pool pool(3);
+	std::atomic<size_t> started{ 0 };
+	auto clock = std::clock();
+	auto start = std::chrono::steady_clock::now();
+	pool.run(4, [&](size_t i) {
+		if (i == 3) {
+			while (started < 3) std::this_thread::yield();
+			return;
+		}
+		started++;
+		std::this_thread::sleep_for(std::chrono::milliseconds(200));
+	});
+	double cpu = (double)(std::clock() - clock) / CLOCKS_PER_SEC, wall = seconds(start);
+
+	char name[96];
+	std::snprintf(name, sizeof(name), "the caller blocks while the workers finish: %.0f ms of cpu in %.0f ms", 1e3 * cpu,
+		1e3 * wall);
+	check(name, wall >= 0.2 && cpu < 0.05);
+}
+
+
+// a long sum of function calls, each term reads the definitions
+static std::string terms(size_t n) {
+	std::string line;
+	for (size_t i = 0; i < n; i++)
+		line += (i ? " + " : "") + std::string(i % 2 ? "f(x, " : "sin(x * ") + std::to_string(i % 7 + 1) + ")";
+	return line;
+}
+
+
+static double per_call(const std::function<void()>& fn, size_t rounds) {
+	auto start = std::chrono::steady_clock::now();
+	for (size_t i = 0; i < rounds; i++) fn();
+	return seconds(start) / rounds;
+}
+
+
+// the split evaluation on the pool against the sequential one of a nested call, an expression
+// is split when its estimated cost reaches PARALLEL_CALC_CUTOFF and a body of a call never is
+static void evaluation() {
+	Definition globals;
+	evaluate("x = 0.5", globals);
+	evaluate("f(a, b) = a * b + sh(a / b)", globals);
+	std::vector<double> argv;
+	auto& pool = Pool::shared();
+
+	for (size_t n : { 0x10, 0x400, 0x1000, 0x10000 }) {
+		auto line = terms(n);
+		evaluate("g() = " + line, globals);
+		auto split = compiled(line), nested = compiled("g()");
+
+		auto jobs = pool.jobs();
+		auto a = calc(split, argv, globals);
+		bool was_split = pool.jobs() > jobs;
+		jobs = pool.jobs();
+		auto b = calc(nested, argv, globals);
+
+		char name[96];
+		std::snprintf(name, sizeof(name), "%zu terms give the sequential result", n);
+		check(name, a && b && a.value() == b.value());
+		std::snprintf(name, sizeof(name), "%zu terms are %s", n, n > 0x10 ? "split on the pool" : "below the cutoff");
+		check(name, was_split == (n > 0x10));
+		check("a body of a call isn't split", pool.jobs() == jobs, true);
+
+		auto rounds = 0x100000 / n;
+		std::printf("     %zu workers: %.1f us split, %.1f us sequential\n", Pool::shared().size(),
+			1e6 * per_call([&] { calc(split, argv, globals); }, rounds),
+			1e6 * per_call([&] { calc(nested, argv, globals); }, rounds));
+	}
+}
+
+
+int main() {
+	exceptions();
+	waiting();
+	evaluation();
+	return finish();
+}
\ No newline at end of file
@@ -0,0 +1,40 @@
+#!/bin/sh
+# builds every test program into tests/build, runs it there and lists the failed ones;
+# CXX and CXXFLAGS may be set, e.g. CXXFLAGS="-O2 -march=x86-64-v3" ./run.sh
+cd "$(dirname "$0")" || exit 1
+CXX=${CXX:-g++}
+CXXFLAGS=${CXXFLAGS:--O2}
+sources="../calculator.cpp ../kernels.cpp ../pool.cpp ../methods.cpp ../export.cpp"
+failed=""
+mkdir -p build
+
+# program, source and extra flags
+run() {
+	program=$1 source=$2
+	shift 2
+	echo "---- $program"
+	if ! $CXX -std=c++17 $CXXFLAGS "$@" -pthread -I.. -Ibuild $source $sources -o build/$program; then
+		failed="$failed $program"
+	elif ! (cd build && ./$program); then
+		failed="$failed $program"
+	fi
+}
+
+run accuracy accuracy.cpp
+run batch batch.cpp
+run types types.cpp
+run fork fork.cpp
+run errors errors.cpp
+run scale scale.cpp
+run methods methods.cpp
+# the split evaluation needs workers, so it is tested even on a single core
+run parallel parallel.cpp -DPOOL_WORKERS=3
+# the first stage writes build/formulas.h, the second one compiles it
+run export export.cpp
+run exported export.cpp -DEXPORTED
+
+if [ -n "$failed" ]; then
+	echo "failed:$failed"
+	exit 1
+fi
+echo "all passed"
\ No newline at end of file
@@ -0,0 +1,48 @@
+// long and deeply nested expressions, the timings show that parsing and evaluation stay linear
+#include "test.h"
+
+
+static void evaluated(const char* name, const std::string& line, double expected, Definition& globals) {
+	auto start = std::chrono::steady_clock::now();
+	auto res = evaluate(line, globals);
+	auto ms = 1e3 * seconds(start);
+
+	bool ok = res && std::fabs(std::strtod(res.value().c_str(), nullptr) - expected) <= 1e-6 * std::max(1.0, std::fabs(expected));
+	char text[128];
+	std::snprintf(text, sizeof(text), "%-32s %9zu chars %10.2f ms  %s", name, line.size(), ms,
+		res ? res.value().c_str() : res.error().what.c_str());
+	check(text, ok);
+}
+
+
+static std::string repeat(const std::string& part, size_t n) {
+	std::string res;
+	res.reserve(part.size() * n);
+	for (size_t i = 0; i < n; i++) res += part;
+	return res;
+}
+
+
+int main() {
+	const size_t tokens = 1000000, nesting = 10000;
+	Definition globals;
+	evaluate("f(x) = x + 1", globals);
+
+	evaluated("flat sum, 1e6 tokens", "1" + repeat("+1", tokens / 2 - 1), tokens / 2, globals);
+	evaluated("flat product, 1e6 tokens", "1" + repeat("*1", tokens / 2 - 1), 1, globals);
+	evaluated("nested brackets, 1e6 levels", repeat("(", tokens) + "1" + repeat(")", tokens), 1, globals);
+	evaluated("nested brackets, 1e4 levels", repeat("(", nesting) + "1" + repeat(")", nesting), 1, globals);
+	evaluated("nested sin(), 1e4 levels", repeat("sin(", nesting) + "0" + repeat(")", nesting), 0, globals);
+	evaluated("nested f(), 1e4 levels", repeat("f(", nesting) + "0" + repeat(")", nesting), nesting, globals);
+	evaluated("unary minus, 1e4 levels", repeat("-", nesting) + "1", 1, globals);
+	evaluated("implicit product, 1e4 levels", repeat("1(1+", nesting) + "0" + repeat(")", nesting), nesting, globals);
+
+	// assignments to new names read them as empty
+	Definition fresh;
+	evaluated("x = x + 1 on a fresh session", "x = x + 1", 1, fresh);
+
+	// a function name taken by a method isn't a pending assignment
+	auto res = evaluate("integrate(sin, 0, sin)", fresh);
+	check("a method name isn't read as empty", !res && res.error().code == Error::undefined_variable_e && res.error().pos == 18);
+	return finish();
+}
\ No newline at end of file
@@ -0,0 +1,65 @@
+#pragma once
+// helpers of the test programs, run.sh builds and runs all of them; a check prints an ok or FAIL line,
+// finish() prints the number of failures and gives the exit code of the program
+#include "calculator.h"
+#include <chrono>
+#include <cstdlib>
+#include <random>
+
+
+using namespace calculator;
+
+
+static size_t failed = 0;
+
+
+// a quiet check prints only a failure, for the checks inside a table
+static bool check(const std::string& name, bool ok, bool quiet = false) {
+	if (!ok || !quiet) std::printf("%-4s %s\n", ok ? "ok" : "FAIL", name.c_str());
+	failed += !ok;
+	return ok;
+}
+
+
+static int finish() {
+	std::printf("%zu failed\n", failed);
+	return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+
+static double seconds(const std::chrono::steady_clock::time_point& start) {
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+
+static const Accuracy modes[] = { libm_a, ulp1_a, ulp4_a };
+static const char* mode_names[] = { "libm", "ulp1", "ulp4" };
+
+
+static Expression compiled(const std::string& line, const std::vector<std::string>& params = {}) {
+	auto tokens = read_expr(line);
+	return compile_expr(tokens.value().begin(), tokens.value().end(), params).value();
+}
+
+
+// the same value bit for bit, any NaN is the same as another one
+template<class T>
+static bool same(T a, T b) {
+	return (a == b && std::signbit(a) == std::signbit(b)) || (std::isnan(a) && std::isnan(b));
+}
+
+
+// calc_batch gives the values of calc point by point
+template<class T>
+static bool matches(const Result<std::vector<T>>& res, const Expression& expr, const std::vector<const T*>& argv, size_t n,
+	Definition& globals) {
+	if (!res) return false;
+
+	std::vector<T> args(argv.size());
+	for (size_t i = 0; i < n; i++) {
+		for (size_t j = 0; j < argv.size(); j++) args[j] = argv[j][i];
+		auto value = calc(expr, args, globals);
+		if (!value || !same(value.value(), res.value()[i])) return false;
+	}
+	return true;
+}
\ No newline at end of file
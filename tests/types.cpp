@@ -0,0 +1,73 @@
+// calc and calc_batch for every scalar type: the batch gives the values of calc point by point,
+// the throughput of both and how far each type gets on a few ill-conditioned lines
+#include "test.h"
+
+
+static const char* lines[] = {
+	"(x * x + 1) / (x - 2) * 3.7 - x",
+	"f(x)",
+	"sqrt(x) + cos(x) * th(x)",
+	"sh(x / 4) - ch(x / 8) + exp(-x) * tg(x) + x^3",
+};
+
+
+// Mval/s of calc and of calc_batch on the same points
+template<class T>
+static void throughput(const Expression& expr, Definition& globals, double* rates) {
+	const size_t n = 1 << 16;
+	std::vector<T> x(n);
+	std::mt19937_64 rng(11);
+	std::uniform_real_distribution<T> dist(0, 10);
+	for (auto& v : x) v = dist(rng);
+
+	// the best of three batches
+	Result<std::vector<T>> res = Error{};
+	rates[1] = 0;
+	for (int run = 0; run < 3; run++) {
+		auto start = std::chrono::steady_clock::now();
+		res = calc_batch<T>(expr, { x.data() }, n, globals);
+		rates[1] = std::max(rates[1], n / seconds(start) / 1e6);
+	}
+
+	auto start = std::chrono::steady_clock::now();
+	bool ok = matches(res, expr, { x.data() }, n, globals);
+	rates[0] = n / seconds(start) / 1e6;
+	check("calc_batch gives the values of calc", ok, true);
+}
+
+
+int main() {
+	for (auto mode : modes) {
+		Definition globals;
+		globals.accuracy = mode;
+		evaluate("f(x) = sin(x) * exp(-x) + x^2 / 3", globals);
+
+		std::printf("%-5s %-48s %17s %17s %17s\n", mode_names[mode], "calc, calc_batch Mval/s", "float",
+			"double", "long double");
+		for (auto line : lines) {
+			auto expr = compiled(line, { "x" });
+			double rates[3][2];
+			throughput<float>(expr, globals, rates[0]);
+			throughput<double>(expr, globals, rates[1]);
+			throughput<long double>(expr, globals, rates[2]);
+
+			std::printf("      %-48s", line);
+			for (auto& rate : rates) std::printf(" %7.2f %9.1f", rate[0], rate[1]);
+			std::printf("\n");
+		}
+	}
+
+	// constants are rounded once for every type, the rest is the precision of the type
+	Definition globals;
+	std::printf("\n%-30s %16s %24s %28s\n", "", "float", "double", "long double");
+	for (auto line : { "0.1 + 0.2 - 0.3", "(1 + 0.0000000001)^10000000000", "1 / 3 * 3 - 1", "sin(100000)" }) {
+		auto expr = compiled(line);
+		std::vector<float> f;
+		std::vector<double> d;
+		std::vector<long double> l;
+		std::printf("%-30s %16.9g %24.17g %28.21Lg\n", line, (double)calc(expr, f, globals).value(),
+			calc(expr, d, globals).value(), calc(expr, l, globals).value());
+	}
+
+	return finish();
+}
\ No newline at end of file